@@ -5,8 +5,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <regex.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
 #include <curses.h>
+#include "libbless.h" // parser, edits and patches
 
 #define TRUE 1
 #define FALSE 0
@@ -16,245 +21,33 @@
 #define HELP_PAIR 3
 #define MESSAGE_PAIR 4
 
+#define PREFETCH_FILES 4 // distinct files warmed ahead of the displayed error
+#define PREFETCH_QUEUE 64 // files waiting for the prefetch thread
+#define PREFETCH_ROWS 256 // rows looked at ahead per move, when the next files have many errors
+
 #define MAIN_MENU 0
 #define INSERT_MENU 1
 
-#define MAIN_MENU_SHORTCUTS "RIGHT  Next error   i  Insert mode  w  Write changes\nLEFT   Prev error   r  Relaunch cmd"
+#define MAIN_MENU_SHORTCUTS "RIGHT  Next error   i  Insert mode  w  Write changes      f  Apply fix-its      u  Undo  U  Redo\nLEFT   Prev error   r  Relaunch cmd p  Root causes first  s  Substitute in all  o  Revert to origin"
 #define INSERT_MENU_SHORTCUTS "RIGHT Next char  UP   First char  enter/esc Main menu    suppr Del next char\nLEFT  Prev char  DOWN backspace Del prev char"
 
-// Error holding double linked list
-
-typedef struct ErrorNode { // double linked node
-	struct ErrorNode *next; // next node
-	struct ErrorNode *prev; // previous node
-	int number; // node number
-	char *filename; // path to the file TODO : maybe split path and filename ?
-	long line_nb; // line number
-	char *function_name; // name of the function the code appears in
-	int error_in_line; // number of error in the line
-	struct StringList* error_msgs; // all error messages
-	char *origin_code; // original code line
-	struct CharList *user_code; // user-modified code line
-	struct StringList *help_list; // help lines
-} ErrorNode;
-
-
-typedef struct ErrorList { // double linked list
-	ErrorNode *head; // head of the double linked list
-	ErrorNode *tail; // tail of the double linked list
-	int size; // number of nodes
-} ErrorList;
-
-
-
-// string holding simple linked list
-
-typedef struct StringNode { // simple linked list
-	struct StringNode *next; // next node
-	char *content; // content
-} StringNode;
-
-
-typedef struct StringList {
-	struct StringNode *head; // head of the linked list
-	struct StringNode *tail; // tail of the linked list
-	int size; // number of nodes
-} StringList;
-
-
-// char-holding linked list
-
-typedef struct CharNode { // double linked list
-	struct CharNode *next; // next node
-	struct CharNode *prev; // previous node
-	char content; // each node contains a char
-} CharNode;
-
-typedef struct CharList { // struct pointing to a char linked list
-	CharNode *head; // head of the linked list
-	CharNode *tail; // tail of the linked list
-	int size; // number of nodes
-} CharList;
-
-
-
-// HELPER FUNCTIONS //
-
-
-void insert_after(CharNode *current, CharNode *newnode, CharList *cl)
-{
-	newnode->prev = current;
-	newnode->next = current->next;
-	current->next = newnode;
-	if (newnode->next == NULL) // insertion after tail
-		cl->tail = newnode; // attach the new tail
-	else
-		newnode->next->prev = newnode; // next's prev is new
-	cl->size += 1;
-}
-
-void insert_before(CharNode *current, CharNode *newnode, CharList *cl)
-{
-	newnode->next = current;
-	newnode->prev = current->prev;
-	current->prev = newnode;
-	if (current->prev == NULL) // insertion before head
-		cl->head = newnode; // attach the new head
-	else
-		newnode->prev->next = newnode; // prev's next is new
-	cl->size += 1;
-}
-
-void delete_after(CharNode *current, CharList *cl)
-{
-	CharNode *temp = current->next;
-	if (temp == NULL) return; // can't delete after tail
-	current->next = temp->next;
-	if (temp->next == NULL) // temp is tail
-		cl->tail = current; // attach the new tail
-	else
-		temp->next->prev = current;
-	cl->size -= 1;
-	free(temp);
-}
-
-void delete_before(CharNode *current, CharList *cl)
-{
-	CharNode *temp = current->prev;
-	if (temp == NULL) return; // can't delete before head
-	current->prev = temp->prev;
-	if (temp->prev == NULL) // temp is head
-		cl->head = current; // attach the new head
-	else
-		temp->prev->next = current;
-	cl->size -= 1;
-	free(temp);
-}
-
-void free_char_list(CharList *cl)
-{
-	CharNode *temp, *node;
-	node = cl->head;
-	while (node != NULL)
-	{
-		temp = node->next;
-		free(node);
-		node = temp;
-	}
-	free(cl);
-}
-
-
-CharList* string_to_cl(char *string)
-{
-	// convert a string to char-holding double linked list (charlist)
-	CharList* charlist = NULL;
-	charlist = malloc(sizeof(CharList));
-	charlist->head = NULL;
-	charlist->tail = NULL;
-	charlist->size = 0;
-
-	for (int i=0; i<strlen(string); i++)
-	{
-		charlist->size += 1;
-
-		CharNode *node = NULL; // creating the node
-		node = malloc(sizeof(CharNode));
-
-		node->next = NULL; // next is null
-		node->prev = charlist->tail; // prev is list's tail
-
-		node->content = string[i]; // content is a char
-
-		if (i == 0)
-			charlist->head = node;
-		else
-			charlist->tail->next = node;
-
-		charlist->tail = node;
-	}
-	return charlist;
-}
+// background prefetch of the upcoming source files
 
+typedef struct Prefetcher { // thread asking the kernel to read the files of the next errors
+	pthread_t thread; // prefetch thread
+	pthread_mutex_t lock; // protects the queue and is_over
+	pthread_cond_t wake; // signaled when files are queued or the thread must stop
+	char *queue[PREFETCH_QUEUE]; // ring of paths waiting to be warmed, owned by the queue
+	int queue_start; // oldest queued path, warmed first
+	int nb_queued; // number of queued paths
+	int is_over; // whether the thread must stop
+	unsigned char *is_warm; // whether each interned file has already been queued, main thread only
+	int nb_ids; // number of flags in is_warm
+} Prefetcher;
 
-char* cl_to_string(CharList *charlist)
-{
-	// convert a charlist content to a string
-	int size = charlist->size+1;
-	char* str = malloc(size);
-	int i = 0;
-	CharNode *node = charlist->head;
-	while (node != NULL)
-	{
-		str[i++] = node->content;
-		node = node->next;
-	}
-	str[size-1] = '\0'; // null-terminated
-	return str;
-}
 
-void print_charlist(CharList *charlist)
-{
-	// display the content of a charlist as a string
-	CharNode *node = charlist->head;
-	printf("str is #");
-	while (node != NULL)
-	{
-		printf("%c", node->content);
-		node = node->next;
-	}
-	printf("#\n");
-}
 
-
-void free_error_list(ErrorList *error_list)
-{
-	// completely free an error list and its member
-	ErrorNode *enode = error_list->head;
-	ErrorNode *etemp = NULL;
-
-	while (enode != NULL)
-	{
-		free(enode->filename);
-		free(enode->function_name);
-
-		StringNode *mnode = enode->error_msgs->head;
-		StringNode *mtemp = NULL;
-
-		while (mnode != NULL)
-		{
-			free(mnode->content);
-			mtemp = mnode;
-			mnode = mnode->next;
-			free(mtemp);
-		}
-		free(enode->error_msgs);
-
-
-		free(enode->origin_code);
-		free_char_list(enode->user_code);
-
-		StringNode *hnode = enode->help_list->head;
-		StringNode *htemp = NULL;
-
-		while (hnode != NULL)
-		{
-			free(hnode->content);
-			htemp = hnode;
-			hnode = hnode->next;
-			free(htemp);
-		}
-		free(enode->help_list);
-
-
-		etemp = enode;
-		enode = enode->next;
-		free(etemp);
-	}
-
-	free(error_list);
-
-}
+// USER INTERFACE //
 
 
 void quit_on_error(char* str, int status)
@@ -266,330 +59,89 @@ void quit_on_error(char* str, int status)
 }
 
 
-// MAIN PROGRAM //
-
-
-ErrorList* runCommand(char* user_cmd)
+char* shown_path(char *path)
 {
-
-	// run the given command and stores the output errrors in an ErrorList
-	FILE *p;
-	char* errors_cmd = " 2>&1 > /dev/null"; // outputs only the errors/warning on stdout
-	int size = strlen(user_cmd)+strlen(errors_cmd)+1;
-	char* cmd = malloc(size); // new string
-	strcpy(cmd, user_cmd); // add the user command
-	strcat(cmd, errors_cmd); // add the error command
-	cmd[size-1] = '\0';
-
-	p = popen(cmd, "r"); // execute the command
-	free(cmd);
-
-	char* tmp;
-	char line[300]; // buffer for reading the output
-	regex_t first_line_expr;
-	regex_t error_expr; // all the error message
-	regex_t code_line_expr;
-	regex_t help_line_expr;
-	regex_t error_expr_line; // the line number of the error
-	int is_new_code = TRUE;
-
-
-	// compile the regexes
-
-	if (regcomp(&first_line_expr, "[a-zA-Z0-9]*\\.c: ", 0) != 0)
-		quit_on_error("Error in regex compilation\n", 1);
-
-	// WARNING : does the error_expr overlap with the first_line_expr ?
-	// TODO : change the error_expr with \\.c instead of .c
-	if (regcomp(&error_expr, "[a-zA-Z0-9]*.c:[0-9]*:[0-9]*:", 0) != 0)
-		quit_on_error("Error in regex compilation\n", 1);
-
-	if (regcomp(&error_expr_line, ".c:[0-9]*:", 0) != 0)
-		quit_on_error("Error in regex compilation\n", 1);
-
-	if (regcomp(&code_line_expr, " *[0-9] |", 0) != 0)
-		quit_on_error("Error in regex compilation\n", 1);
-
-	if (regcomp(&help_line_expr, " *[^0-9] |", 0) != 0)
-		quit_on_error("Error in regex compilation\n", 1);
-
-
-	regmatch_t matchptr[1];
-
-	ErrorList *error_list = NULL; // creating the error list
-	error_list = malloc(sizeof(ErrorList));
-	error_list->size = 0;
-	error_list->head = NULL;
-	error_list->tail = NULL;
-
-	char *filename = NULL; // name of the file where the error is
-	char *function_name = NULL; // name of the function the error is
-
-
-	for (int row=0; row<300; row++) // TODO : replace the for by a while, until EOF
-	{
-		tmp = fgets(line, 300, p);
-		if (tmp == NULL) break;
-
-		if (regexec(&first_line_expr, line, 1, matchptr, 0) == 0)
-		{
-			// finding a first line expression
-			int delim = matchptr->rm_eo-1;
-
-			if (filename != NULL)
-				free(filename); // already used, free first
-			filename = malloc(delim*sizeof(char));
-			strncpy(filename, line, delim-1);
-			filename[delim-1] = '\0'; // null char
-
-			if (function_name != NULL)
-				free(function_name); // already used, free first
-			function_name = malloc((strlen(line)-delim-1)*sizeof(char));
-			strncpy(function_name, line+delim, strlen(line)-delim-2);
-			function_name[strlen(line)-delim-2] = '\0'; // null char
-		}
-
-
-		if (regexec(&error_expr, line, 1, matchptr, 0) == 0)
-		{
-			// finding an error expression
-			is_new_code = TRUE;
-			int delim = matchptr->rm_eo;
-			long line_nb_from_str = -1;
-
-
-			if (regexec(&error_expr_line, line, 1, matchptr, 0) == 0)
-			{
-				// finding the line number
-				line_nb_from_str = strtoll(line+matchptr->rm_so+3, NULL, 10);
-			}
-			else
-				printf("Error : did not match!\n");
-
-
-			int isOnSameLine = FALSE;
-			if (error_list->size >= 1)
-			{
-				if (strcmp(error_list->tail->filename, filename) == 0 && error_list->tail->line_nb == line_nb_from_str)
-				{
-					// the error is on the same line as the previous error
-					isOnSameLine = TRUE;
-				}
-			}
-
-			if (isOnSameLine == TRUE)
-			{
-				// add the error message to the StringList error_msgs
-				StringList *sl = error_list->tail->error_msgs;
-				StringNode *msg_node = NULL;
-				msg_node = malloc(sizeof(StringNode));
-				msg_node->next = NULL;
-
-				char *msg_error = malloc(strlen(line)-delim+1);
-				strncpy(msg_error, line+delim+1, strlen(line)-delim);
-				msg_node->content = msg_error; // set the error msg of the node
-
-
-				sl->tail->next = msg_node;
-				sl->tail = msg_node;
-				sl->size += 1;
-
-			}
-			else
-			{
-
-				error_list->size += 1; // increment the ErrorNode counter
-
-				ErrorNode *error_node = NULL; // create the next error node;
-				error_node = malloc(sizeof(ErrorNode));
-
-
-				error_node->number = error_list->size; // set the error nb
-
-				error_node->filename = malloc(strlen(filename)+1);
-				strcpy(error_node->filename, filename); // set the filename
-
-				error_node->function_name = malloc(strlen(function_name)+1);
-				strcpy(error_node->function_name, function_name); // set the function_name
-
-				error_node->line_nb = line_nb_from_str; // set the error line number
-
-				// create a new StringList for the error messages
-				StringList *error_msgs = NULL;
-				error_msgs = malloc(sizeof(StringList));
-
-				StringNode *msg_node = NULL;
-				msg_node = malloc(sizeof(StringNode));
-				msg_node->next = NULL;
-
-				char *msg_error = malloc(strlen(line)-delim+1);
-				strncpy(msg_error, line+delim+1, strlen(line)-delim);
-				msg_node->content = msg_error; // set the error msg of the node
-
-				error_msgs->head = msg_node;
-				error_msgs->tail = msg_node;
-
-				error_msgs->size = 1;
-				error_node->error_msgs = error_msgs;
-
-
-				error_node->prev = error_list->tail; // link the node to the prev one
-				error_node->next = NULL; // next node is NULL
-
-				if (error_list->size == 1)
-				{
-					error_list->head = error_node; // first error -> set the head
-				}
-				else
-				{
-					error_list->tail->next = error_node; // set the actual tail's next to the node
-				}
-
-				error_list->tail = error_node;
-
-				StringList *help_list = NULL;
-				help_list = malloc(sizeof(StringList));
-
-
-				error_node->help_list = help_list; // allocating the help_list
-
-				error_node->help_list->size = 0;
-				error_node->help_list->head = NULL;
-				error_node->help_list->tail = NULL;
-			}
-		}
-
-		if (regexec(&code_line_expr, line, 1, matchptr, 0) == 0)
-		{
-
-
-			if (is_new_code == TRUE)
-			{
-				char *code_origin = malloc(strlen(line)-matchptr->rm_eo); // reserve space
-				strcpy(code_origin, matchptr->rm_eo+line+1); // copy the code line
-				error_list->tail->origin_code = code_origin;
-				error_list->tail->user_code = string_to_cl(code_origin);
-				is_new_code = FALSE;
-			}else
-			{
-				StringList *hl = error_list->tail->help_list;
-				hl->size += 1;
-
-				StringNode *help_temp = NULL;
-				help_temp = malloc(sizeof(StringNode));
-
-				help_temp->next = NULL;
-				char *help_line = malloc(strlen(line)-matchptr->rm_eo); // reserve space
-				strcpy(help_line, matchptr->rm_eo+line+1); // copy the help line with an offset
-				help_temp->content = help_line; // assigning the content
-
-				if (hl->size == 1)
-				{
-					hl->head = help_temp;
-				}
-				else
-				{
-					hl->tail->next = help_temp;
-				}
-
-				hl->tail = help_temp;
-			}
-
-		}
-
-		if (regexec(&help_line_expr, line, 1, matchptr, 0) == 0)
-		{
-			StringList *hl = error_list->tail->help_list;
-			hl->size += 1;
-
-			StringNode *help_temp = NULL;
-			help_temp = malloc(sizeof(StringNode));
-
-			char *help_line = malloc(strlen(line)-matchptr->rm_eo); // reserve space
-			strcpy(help_line, matchptr->rm_eo+line+1); // copy the help line with an offset
-			help_temp->content = help_line; // assigning the content
-
-			help_temp->next = NULL;
-
-			if (hl->size == 1)
-			{
-				hl->head = help_temp;
-			}
-			else
-			{
-				hl->tail->next = help_temp;
-			}
-
-			hl->tail = help_temp;
-		}
-
-
-	}
-
-	// free the popen
-	pclose(p);
-
-	free(function_name);
-	free(filename);
-
-	// free the compiled regexes
-	regfree(&first_line_expr);
-	regfree(&error_expr);
-	regfree(&code_line_expr);
-	regfree(&help_line_expr);
-	regfree(&error_expr_line);
-
-	return error_list;
+	// the parser resolves absolute paths, show them relative to the current directory when under it
+	static char cwd[4096] = "";
+	if (cwd[0] == '\0' && getcwd(cwd, sizeof(cwd)) == NULL)
+		return path;
+	int len = strlen(cwd);
+	if (strncmp(path, cwd, len) == 0 && path[len] == '/')
+		return path+len+1;
+	return path;
 }
 
 
-void display_error(ErrorNode *node, int total_error)
+void display_error(BlessErrorList *el, int row)
 {
-	// display the content of an ErrorNode
+	// display the content of a row
 	int line_cmp = 0;
-	char str_number[15];
-
-	sprintf(str_number, "Error %d/%d", node->number, total_error);
+	char str_number[80];
+	BlessDiagnostic diag;
+	BlessFixIt fixit;
+	bless_diagnostic(el, row, &diag);
+
+	if (diag.cause >= 0)
+		sprintf(str_number, "Error %d/%d  (likely caused by error %d)", row+1, bless_nb_rows(el), diag.cause+1);
+	else if (diag.nb_cascades > 0)
+		sprintf(str_number, "Error %d/%d  (root cause %d/%d, %d cascades folded)", row+1, bless_nb_rows(el), diag.rank+1, bless_nb_root_causes(el), diag.nb_cascades);
+	else
+		sprintf(str_number, "Error %d/%d  (root cause %d/%d)", row+1, bless_nb_rows(el), diag.rank+1, bless_nb_root_causes(el));
 
 	mvaddstr(line_cmp++, 0, str_number); // error number
-	mvaddstr(line_cmp++, 0, node->filename); // filename
-	mvaddstr(line_cmp++, 0, node->function_name); // function_name
-
-	StringList *error_msg_list = node->error_msgs;
-	StringNode *error_msg_node = error_msg_list->head;
+	mvaddstr(line_cmp++, 0, shown_path((char*)diag.file)); // filename
+	mvaddstr(line_cmp++, 0, diag.function); // function_name
 
 	// print the error messages
 	attron(COLOR_PAIR(ERROR_PAIR));
-	for (int i=0; i<error_msg_list->size; i++)
+	for (int i=0; i<diag.nb_messages; i++)
 	{
 		sprintf(str_number, "%d : ", i+1);
 		mvaddstr(line_cmp++, 0, str_number); // error nb
-		addstr(error_msg_node->content); // error message
-		error_msg_node = error_msg_node->next;
+		addstr(bless_error_msg(el, row, i)); // error message
 	}
 	attroff(COLOR_PAIR(ERROR_PAIR));
 
 	// print the code line
 	attron(COLOR_PAIR(CODE_PAIR));
-	char *str = cl_to_string(node->user_code);
+	char *str = bless_pt_to_string(el, row);
 	mvaddstr(line_cmp++, 0, str); // code with error, editable by user
 	free(str);
 	attroff(COLOR_PAIR(CODE_PAIR));
 	line_cmp++; // jump a line
-	mvaddstr(line_cmp++, 0, node->origin_code); // code with error, original
-
-	StringList *help_list = node->help_list;
-	StringNode *help_node = help_list->head;
+	mvaddstr(line_cmp++, 0, bless_origin_code(el, row)); // code with error, original
 
 	// print the help messages
 	attron(COLOR_PAIR(HELP_PAIR));
-	for (int i = 0; i < help_list->size; i++)
+	for (int i = 0; i < diag.nb_help; i++)
 	{
-		mvaddstr(line_cmp++, 0, help_node->content); // help line
-		help_node = help_node->next;
+		mvaddstr(line_cmp++, 0, bless_help_line(el, row, i)); // help line
 	}
 	attroff(COLOR_PAIR(HELP_PAIR));
 
+	for (int i=0; bless_fixit(el, i, &fixit); i++)
+	{
+		// print the fix-it hints of the error
+		if (fixit.row != row) continue;
+		sprintf(str_number, "Fix-it %d:%d-%d:%d%s : ", fixit.line_start, fixit.col_start,
+			fixit.line_end, fixit.col_end, fixit.is_applied ? " (applied)" : "");
+		mvaddstr(++line_cmp, 0, str_number);
+		addstr(fixit.text);
+	}
+
+	if (diag.occurrences > 1)
+	{
+		// print where a repeated error comes from
+		sprintf(str_number, "Reported %d", diag.occurrences);
+		mvaddstr(++line_cmp, 0, str_number);
+		addstr(" times, from :");
+		for (int i=0; i<diag.nb_units; i++)
+		{
+			addstr(" ");
+			addstr(shown_path(bless_unit_path(el, row, i)));
+		}
+	}
+
 	return;
 }
 
@@ -614,6 +166,7 @@ void display_interface(int menuType)
 
 }
 
+
 void display_message(char *str)
 {
 	// display a message
@@ -630,9 +183,28 @@ void display_message(char *str)
 }
 
 
-int edit(WINDOW *screen, ErrorNode *en)
+void prompt_string(char *label, char *buf, int size)
+{
+	// ask the user for a line of text on the message line
+	move(LINES-5,0);
+	clrtoeol(); // erase any previous message
+	attron(COLOR_PAIR(MESSAGE_PAIR));
+	mvaddstr(LINES-5, 0, label);
+	attroff(COLOR_PAIR(MESSAGE_PAIR));
+
+	echo();
+	curs_set(1);
+	if (getnstr(buf, size-1) == ERR)
+		buf[0] = '\0';
+	curs_set(0);
+	noecho();
+}
+
+
+int edit(WINDOW *screen, BlessErrorList *el, int row)
 {
 	// edit the code containing an error and returns TRUE if at least one edit has been made
+	// all the edits of one call are undone together
 	noecho(); // don't display what is typed
 	curs_set(1); // cursor visible
 
@@ -640,14 +212,15 @@ int edit(WINDOW *screen, ErrorNode *en)
 	char chr;
 	int is_over = FALSE;
 	int cur_x = 0; // cursor x position
-	int cur_y = 3+en->error_msgs->size; // edit line is after 3lines + nb of error messages from the top
+	BlessDiagnostic diag;
+	bless_diagnostic(el, row, &diag);
+	int cur_y = 3+diag.nb_messages; // edit line is after 3lines + nb of error messages from the top
 	int hasEdit = FALSE; // no edit made
 
 	move(cur_y,cur_x); // move cursor to (0,4)
 	refresh();
 
-	CharList *charlist = en->user_code;
-	CharNode *charnode = charlist->head;
+	BlessPieceTable *pt = bless_row_piece_table(el, row);
 	attron(COLOR_PAIR(CODE_PAIR));
 
 	while (!is_over)
@@ -660,7 +233,6 @@ int edit(WINDOW *screen, ErrorNode *en)
 				if (cur_x-1 >= 0)
 				{
 					cur_x -= 1;
-					charnode = charnode->prev;
 					move(cur_y, cur_x);
 					refresh();
 				}
@@ -668,10 +240,9 @@ int edit(WINDOW *screen, ErrorNode *en)
 
 			case KEY_RIGHT:
 				// move cursor one char to the right if possible
-				if (cur_x+1 < charlist->size)
+				if (cur_x+1 < bless_pt_length(pt))
 				{
 					cur_x += 1;
-					charnode = charnode->next;
 					move(cur_y, cur_x);
 					refresh();
 				}
@@ -679,8 +250,7 @@ int edit(WINDOW *screen, ErrorNode *en)
 
 			case KEY_DOWN:
 				// move cursor to the last char
-				cur_x = charlist->size - 1;
-				charnode = charlist->tail;
+				cur_x = (bless_pt_length(pt) > 0) ? bless_pt_length(pt) - 1 : 0;
 				move(cur_y, cur_x);
 				refresh();
 				break;
@@ -688,7 +258,6 @@ int edit(WINDOW *screen, ErrorNode *en)
 			case KEY_UP:
 				// move cursor to the first char
 				cur_x = 0;
-				charnode = charlist->head;
 				move(cur_y, cur_x);
 				refresh();
 				break;
@@ -696,57 +265,44 @@ int edit(WINDOW *screen, ErrorNode *en)
 
 			case 10: // enter key
 			case 27: // Escape key
+			case ERR: // terminal lost
 				is_over = TRUE;
 				break;
 
 			case 330: // suppr key
-				//remove the charnode after the current
-				if (cur_x != charlist->size-1) // remove tail
+				// remove the char under the cursor, except the end of line
+				if (cur_x < bless_pt_length(pt)-1)
 				{
-					delete_after(charnode, charlist);
+					if (!hasEdit) bless_pt_begin_change(pt);
+					bless_pt_delete(pt, cur_x);
 					mvdelch(cur_y, cur_x);
 					move(cur_y,cur_x);
 					refresh();
+					hasEdit = TRUE;
 				}
-				hasEdit = TRUE;
 				break;
 
 			case KEY_BACKSPACE:
 			case 127:
 			case '\b':
-				// remove the charnode before the current node
+				// remove the char before the cursor
 				if (cur_x != 0)
 				{
-					delete_before(charnode, charlist);
+					if (!hasEdit) bless_pt_begin_change(pt);
+					bless_pt_delete(pt, cur_x-1);
 					cur_x -= 1;
 					mvdelch(cur_y, cur_x);
 					refresh();
+					hasEdit = TRUE;
 				}
-				hasEdit = TRUE;
 				break;
 
 
 			default:
-				// insert charnode before the current node
-
-				// TODO: use the beautiful insert_before function
-
+				// insert the char before the cursor
 				chr = c;
-				CharNode *newnode = NULL;
-				newnode = malloc(sizeof(CharNode));
-
-				newnode->content = chr;
-				newnode->next = charnode;
-				newnode->prev = charnode->prev;
-
-				if (cur_x == 0)// head insertion
-					charlist->head = newnode;
-				else
-					charnode->prev->next = newnode;
-
-				charnode->prev = newnode;
-
-				charlist->size += 1;
+				if (!hasEdit) bless_pt_begin_change(pt);
+				bless_pt_insert(el, pt, cur_x, chr);
 				mvinsch(cur_y, cur_x, chr);
 				refresh();
 				cur_x += 1;
@@ -759,125 +315,341 @@ int edit(WINDOW *screen, ErrorNode *en)
 	attroff(COLOR_PAIR(CODE_PAIR));
 	curs_set(0);
 	noecho();
+	if (hasEdit)
+		bless_set_edited(el, row, TRUE);
 	return hasEdit;
 }
 
 
-int place_in_file(ErrorList *el)
+void* prefetch_loop(void *arg)
 {
-	// for every node in the ErrorList, write the user-modified code at the specified line
-	char cp_buf[300];
-	int nb_line = 1;
-	char *filename = NULL;
-	char *temp_name = NULL; // temporary name for the destination file
-	int shouldOpenFile = TRUE; // whether we should open the files
-	int isError = FALSE; // no error has happened
+	// prefetch thread : open the queued files and let the kernel read them ahead, off the UI thread
+	Prefetcher *prefetcher = arg;
+	pthread_mutex_lock(&prefetcher->lock);
+	while (!prefetcher->is_over)
+	{
+		if (prefetcher->nb_queued == 0)
+		{
+			pthread_cond_wait(&prefetcher->wake, &prefetcher->lock);
+			continue;
+		}
+		char *path = prefetcher->queue[prefetcher->queue_start]; // in request order, the nearest file first
+		prefetcher->queue_start = (prefetcher->queue_start+1) % PREFETCH_QUEUE;
+		prefetcher->nb_queued--;
+		pthread_mutex_unlock(&prefetcher->lock);
 
-	FILE *forigin = NULL;
-	FILE *fnew = NULL;
+		int fd = open(path, O_RDONLY); // may block on a cold network file system, only this thread waits
+		if (fd >= 0)
+		{
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED); // asynchronous readahead of the whole file
+			close(fd);
+		}
+		free(path);
+
+		pthread_mutex_lock(&prefetcher->lock);
+	}
+	pthread_mutex_unlock(&prefetcher->lock);
+	return NULL;
+}
 
-	ErrorNode *node = el->head;
 
-	while (node != NULL)
+Prefetcher* start_prefetcher()
+{
+	// start the prefetch thread, NULL if it cannot be created
+	Prefetcher *prefetcher = calloc(1, sizeof(Prefetcher));
+	pthread_mutex_init(&prefetcher->lock, NULL);
+	pthread_cond_init(&prefetcher->wake, NULL);
+	if (pthread_create(&prefetcher->thread, NULL, prefetch_loop, prefetcher) != 0)
 	{
+		pthread_mutex_destroy(&prefetcher->lock);
+		pthread_cond_destroy(&prefetcher->wake);
+		free(prefetcher);
+		return NULL; // Bless still works, reading the files when needed
+	}
+	return prefetcher;
+}
 
-		filename = node->filename;
 
-		if (shouldOpenFile == TRUE)
-		{
-		        forigin = fopen(filename, "r"); // origin file
-			temp_name = malloc(sizeof(filename)+6); // filename+".temp"
-		        fnew = fopen(temp_name, "w"); // destination file*
-			shouldOpenFile = FALSE;
-		}
+void reset_prefetcher(Prefetcher *prefetcher, BlessErrorList *el)
+{
+	// forget the warmed files of a previous BlessErrorList
+	if (prefetcher == NULL)
+		return;
+	free(prefetcher->is_warm);
+	prefetcher->nb_ids = bless_nb_interned(el);
+	prefetcher->is_warm = calloc(prefetcher->nb_ids+1, sizeof(unsigned char));
+}
 
 
-		while (nb_line < node->line_nb)
-		{
-			if (fgets(cp_buf, 300, forigin) != NULL)
-			{
-				if (strlen(cp_buf) != 300) // buffer not full
-					nb_line ++; // we found an end of line
-				fputs(cp_buf, fnew); // copy the line in the new file
-			}
-		}
+void prefetch_ahead(Prefetcher *prefetcher, BlessErrorList *el, int row, int direction, int isPriority)
+{
+	// queue the next PREFETCH_FILES distinct files in the navigation direction, nearest first
+	// the files already warmed count too, so the walk stays short once everything is warm, never blocks on IO
+	if (prefetcher == NULL)
+		return;
+	int seen[PREFETCH_FILES]; // distinct files met so far
+	int nb_seen = 0;
+	int nb_queued = 0;
+	int nb_rows = 0;
+	pthread_mutex_lock(&prefetcher->lock);
+	for (int r=row; r >= 0 && nb_seen < PREFETCH_FILES && nb_rows < PREFETCH_ROWS; r=bless_next_row(el, r, direction, isPriority))
+	{
+		BlessDiagnostic diag;
+		bless_diagnostic(el, r, &diag);
+		int id = diag.file_id;
+		int isSeen = FALSE;
+		nb_rows++;
+		for (int i=0; i<nb_seen; i++)
+			isSeen |= (seen[i] == id);
+		if (isSeen) continue;
+		seen[nb_seen++] = id;
+		if (id < 0 || id >= prefetcher->nb_ids || prefetcher->is_warm[id]) continue;
+		if (prefetcher->nb_queued == PREFETCH_QUEUE)
+			break; // the thread is late, try again at the next move
+		prefetcher->queue[(prefetcher->queue_start+prefetcher->nb_queued) % PREFETCH_QUEUE] = strdup(bless_interned(el, id));
+		prefetcher->nb_queued++;
+		prefetcher->is_warm[id] = TRUE;
+		nb_queued++;
+	}
+	if (nb_queued > 0)
+		pthread_cond_signal(&prefetcher->wake);
+	pthread_mutex_unlock(&prefetcher->lock);
+}
 
-		// put the user-modified code in the new file
-		fputs(cl_to_string(node->user_code), fnew);
-		nb_line ++;
 
-	        // read the new line but don't write it in the new
-	        do
-	        {
-	                fgets(cp_buf, 300, forigin);
-	        } while (strlen(cp_buf) == 300);
+void stop_prefetcher(Prefetcher *prefetcher)
+{
+	// stop the prefetch thread, the files still queued are dropped
+	if (prefetcher == NULL)
+		return;
+	pthread_mutex_lock(&prefetcher->lock);
+	prefetcher->is_over = TRUE;
+	pthread_cond_signal(&prefetcher->wake);
+	pthread_mutex_unlock(&prefetcher->lock);
+	pthread_join(prefetcher->thread, NULL);
+
+	for (int i=0; i<prefetcher->nb_queued; i++)
+		free(prefetcher->queue[(prefetcher->queue_start+i) % PREFETCH_QUEUE]);
+	pthread_mutex_destroy(&prefetcher->lock);
+	pthread_cond_destroy(&prefetcher->wake);
+	free(prefetcher->is_warm);
+	free(prefetcher);
+}
 
-		node = node->next; // change the node
 
-		char *tmp = "NULL";
-		if (node != NULL)
-			tmp = node->filename;
+// SHARED SESSION CLIENT //
 
-		if ( strcmp(tmp, filename) != 0 )
-		{
-			// the error is in another file or this is the last node
-		        // copy everything to the end in the new file
-		        while ( !feof(forigin) )
-		        {
-		                if (fgets(cp_buf, 300, forigin) != NULL)
-				{
-		                        fputs(cp_buf, fnew); // copy the line in the new file
-				}
-		        }
 
-		        // closing the files
-		        fclose(forigin);
-		        fclose(fnew);
-			if (rename(temp_name,filename) != 0)
-			{
-				isError = TRUE; // an error has happened !
-				break;
-			}
-			shouldOpenFile = TRUE; // we have to open new files
+void share_row(BlessConnection *conn, BlessErrorList *el, int row)
+{
+	// send an edited line to the daemon, a lost daemon is noticed by the next client_key
+	char *str = bless_pt_to_string(el, row);
+	bless_send(conn, "EDIT", row, bless_is_edited(el, row), str);
+	free(str);
+}
+
+
+char* client_update(BlessConnection *conn, BlessErrorList **el, int *row, char **command, char *msg_buf)
+{
+	// apply the messages of the daemon, returns the text to display or NULL
+	BlessMessage msg;
+	char *message = NULL;
+
+	if (bless_conn_fill(conn))
+		quit_on_error("The daemon has stopped", 1);
+	while (bless_conn_next(conn, &msg))
+	{
+		if (strcmp(msg.kind, "CMD") == 0)
+		{
+			free(*command);
+			*command = strdup(msg.text);
 		}
+		else if (strcmp(msg.kind, "LOAD") == 0 && *command != NULL)
+		{
+			int unused;
+			BlessErrorList *loaded = bless_load_session(msg.text, *command, &unused); // mapped, shared with the daemon and the other clients
+			if (loaded == NULL)
+				quit_on_error("Cannot map the session of the daemon", 1);
+			if (*el != NULL)
+				bless_free_error_list(*el);
+			*el = loaded;
+			*row = 0;
+			sprintf(msg_buf, "Launch %d of the daemon, %d errors %d warnings", msg.row,
+				bless_count_severity(loaded, BLESS_SEVERITY_ERROR)+bless_count_severity(loaded, BLESS_SEVERITY_FATAL),
+				bless_count_severity(loaded, BLESS_SEVERITY_WARNING));
+			message = msg_buf;
+		}
+		else if (strcmp(msg.kind, "EDIT") == 0 && *el != NULL && msg.row >= 0 && msg.row < bless_nb_rows(*el))
+		{
+			char *current = bless_has_user_code(*el, msg.row) ? bless_pt_to_string(*el, msg.row) : NULL;
+			if (current == NULL || strcmp(current, msg.text) != 0)
+				bless_stage_edit(*el, msg.row, msg.text); // edit of another client, can be undone here
+			free(current);
+			bless_set_edited(*el, msg.row, msg.flag);
+		}
+		else if (strcmp(msg.kind, "MSG") == 0)
+		{
+			snprintf(msg_buf, 80, "%s", msg.text);
+			message = msg_buf;
+		}
+	}
+	return message;
+}
+
 
+int client_key(BlessConnection *conn, BlessErrorList **el, int *row, char **command, char **message, char *msg_buf)
+{
+	// wait for a key or for the daemon, returns 0 once its messages are applied
+	timeout(0);
+	int c = getch(); // key already read by curses
+	timeout(-1);
+	if (c != ERR)
+		return c;
+
+	struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {bless_conn_fd(conn), POLLIN, 0}};
+	if (poll(fds, 2, -1) < 0)
+		return 0; // interrupted, e.g. by a resize
+	if (fds[1].revents != 0)
+	{
+		char *update = client_update(conn, el, row, command, msg_buf);
+		if (update != NULL)
+			*message = update;
+		return 0;
 	}
+	return getch();
+}
+
 
-	return isError;
+void keep_session(char *session_path, BlessErrorList *el, char *command, int row, int hasEdit)
+{
+	// save the session while edits are pending, once they are all written the next start relaunches
+	if (hasEdit)
+		bless_save_session(session_path, el, command, row);
+	else
+		unlink(session_path);
 }
 
 
 // MAIN FUNCTION //
 
 
+void on_hangup(int sig)
+{
+	// the terminal is gone (e.g. disconnected ssh session) : don't die, getch returns ERR from now on
+}
+
+
+void on_stop(int sig)
+{
+	// the daemon is killed : it saves its last edits and removes its socket, the session stays on disk
+	bless_stop_serving();
+}
+
+
 int main(int argc, char* argv[])
 {
 	WINDOW *screen;
+	char *session_path = BLESS_SESSION_FILE; // where the session is saved
+	int shouldResume = TRUE; // whether a saved session can replace the first launch
+	int isLog = FALSE; // whether the argument is a build log to read instead of a command
+	int max_errors = 0; // errors captured before the command is stopped, 0 to let it finish
+	int isFirstUnit = FALSE; // whether the command is stopped after the first translation unit with errors
+	int isStopped = FALSE; // whether the last launch was stopped early
+	int isDaemon = FALSE; // whether the launch is served to clients instead of displayed
+	char *socket_path = BLESS_SOCKET_FILE; // socket of the daemon
+	int isClient = FALSE; // whether the errors come from a daemon
+	BlessConnection *conn = NULL; // daemon of a client, NULL when Bless runs alone
+	int first_arg = 1; // first argument of the command
+
+	// options of Bless, before the command
+	while (first_arg < argc && argv[first_arg][0] == '-')
+	{
+		if (strcmp(argv[first_arg], "-n") == 0)
+			shouldResume = FALSE;
+		else if (strcmp(argv[first_arg], "-s") == 0 && first_arg+1 < argc)
+			session_path = argv[++first_arg];
+		else if (strcmp(argv[first_arg], "-l") == 0)
+			isLog = TRUE;
+		else if (strcmp(argv[first_arg], "-e") == 0 && first_arg+1 < argc)
+			max_errors = atoi(argv[++first_arg]);
+		else if (strcmp(argv[first_arg], "-u") == 0)
+			isFirstUnit = TRUE;
+		else if (strcmp(argv[first_arg], "-d") == 0)
+			isDaemon = TRUE;
+		else if (strcmp(argv[first_arg], "-S") == 0 && first_arg+1 < argc)
+			socket_path = argv[++first_arg];
+		else if (strcmp(argv[first_arg], "-c") == 0)
+			isClient = TRUE;
+		else
+			break; // unknown option, part of the command
+		first_arg++;
+	}
+
+	if (isClient)
+	{
+		conn = bless_connect(socket_path);
+		if (conn == NULL)
+		{
+			printf("No daemon listens on %s\n", socket_path);
+			exit(1);
+		}
+	}
 
-	if (argc == 1)
+	if (first_arg >= argc && conn == NULL)
 	{
-		printf("Usage is ./exe arg1 arg2 arg3 ...\n");
+		printf("Usage is ./exe [-n] [-s session_file] [-e N] [-u] arg1 arg2 arg3 ...\n");
+		printf("      ./exe [-n] [-s session_file] -l build.log[.gz|.zst]\n");
+		printf("      ./exe -d [-S socket] [-s session_file] [-l] arg1 arg2 arg3 ...\n");
+		printf("      ./exe [-S socket] -c\n");
+		printf("  -n  don't resume the saved session, relaunch the command\n");
+		printf("  -s  session file, %s by default\n", BLESS_SESSION_FILE);
+		printf("  -l  read the errors from a build log, plain or compressed, instead of running a command\n");
+		printf("  -e  stop the command once N errors are captured\n");
+		printf("  -u  stop the command once the first file with errors is compiled\n");
+		printf("  -d  daemon : launch once and share the errors and edits with the clients on the socket\n");
+		printf("  -S  socket of the daemon, %s by default\n", BLESS_SOCKET_FILE);
+		printf("  -c  client of the daemon\n");
 		exit(1);
 	}
 
 	int size = 0;
 	int i;
+	char *command = NULL; // sent by the daemon to its clients
 
 	// putting all the arguments into one string
-	for (i=1; i<argc; i++)
+	for (i=first_arg; i<argc; i++)
 	{
 		size += strlen(argv[i])+1; // counting arglen+space
 	}
 
-	char *command = malloc(size*sizeof(char));
-	strcpy(command, argv[1]); // copy the first arg
+	if (conn == NULL)
+	{
+		command = malloc(size*sizeof(char));
+		strcpy(command, argv[first_arg]); // copy the first arg
+
+		for (i=first_arg+1; i<argc; i++)
+		{
+			strcat(command, " "); // add a space
+			strcat(command, argv[i]); // add all args in one string
+		}
+		command[size-1] = '\0'; // null-terminated string
+	}
 
-	for (i=2; i<argc; i++)
+	if (isDaemon)
 	{
-		strcat(command, " "); // add a space
-		strcat(command, argv[i]); // add all args in one string
+		signal(SIGINT, on_stop);
+		signal(SIGTERM, on_stop);
+		printf("Launching %s, then serving it on %s\n", command, socket_path);
+		fflush(stdout);
+		if (bless_serve(socket_path, session_path, command, isLog, max_errors, isFirstUnit))
+		{
+			printf("Cannot serve %s (build log unreadable or socket in use)\n", socket_path);
+			exit(1);
+		}
+		exit(0);
 	}
-	command[size-1] = '\0'; // null-terminated string
+
+	signal(SIGHUP, on_hangup); // save the session instead of dying with the terminal
 
 	// curses initialization
         screen = initscr();
@@ -899,26 +671,93 @@ int main(int argc, char* argv[])
 	int shouldClear = TRUE; // whether we shoud clear the screen
 	int hasEdit = FALSE; // no edit for now
 	int hasSaved = TRUE; // whether the origin files have been made
+	int isPriority = FALSE; // whether only the root causes are visited, best first
+	int direction = 1; // direction of the last move, 1 forward and -1 backward
 	char *message = NULL;
 
-	ErrorList* error_list = NULL;
-	ErrorNode* node = NULL;
+	BlessErrorList* error_list = NULL;
+	int row = 0; // row being displayed
+	char launch_msg[80];
 
-	while (isRelaunch)
-	{
+	Prefetcher *prefetcher = start_prefetcher(); // warms the files of the next errors
 
-		error_list = runCommand(command); // run the command
-		node = error_list->head;
+	int nb_changed = 0; // files modified since the resumed session
+	if (shouldResume && conn == NULL)
+		error_list = bless_load_session(session_path, command, &row);
+	if (error_list != NULL)
+	{
+		// without pending edits, a session whose files changed shows old errors : relaunch instead
+		int hasPending = FALSE;
+		for (int r=0; r<bless_nb_rows(error_list); r++)
+			hasPending |= bless_is_edited(error_list, r);
+		nb_changed = bless_changed_files(error_list);
+		if (nb_changed > 0 && !hasPending)
+		{
+			bless_free_error_list(error_list);
+			error_list = NULL;
+			row = 0;
+		}
+	}
+	int isResumed = (error_list != NULL); // whether the first launch is replaced by the session
 
+	while (isRelaunch)
+	{
 
-		if (error_list->size == 0)
+		if (conn != NULL)
 		{
-			endwin();
-			printf("The compiled program shows no error!\n");
-			exit(0);
+			// the daemon launched the command, the list is replaced by each of its launches
+			while (error_list == NULL)
+				client_update(conn, &error_list, &row, &command, launch_msg);
+			sprintf(launch_msg, "Connected, %d errors %d warnings",
+				bless_count_severity(error_list, BLESS_SEVERITY_ERROR)+bless_count_severity(error_list, BLESS_SEVERITY_FATAL),
+				bless_count_severity(error_list, BLESS_SEVERITY_WARNING));
 		}
+		else if (isResumed)
+		{
+			isResumed = FALSE;
+			for (int r=0; r<bless_nb_rows(error_list); r++)
+			{
+				if (bless_is_edited(error_list, r))
+				{
+					hasEdit = TRUE; // edits pending from the last session
+					hasSaved = FALSE;
+				}
+			}
+			if (nb_changed > 0)
+				sprintf(launch_msg, "Session resumed with its edits, %d files changed since (r to relaunch)", nb_changed);
+			else
+				sprintf(launch_msg, "Session resumed, %d errors %d warnings (r to relaunch)",
+					bless_count_severity(error_list, BLESS_SEVERITY_ERROR)+bless_count_severity(error_list, BLESS_SEVERITY_FATAL),
+					bless_count_severity(error_list, BLESS_SEVERITY_WARNING));
+		}
+		else
+		{
+			if (error_list != NULL)
+				bless_free_error_list(error_list); // previous launch
+			if (isLog)
+				error_list = bless_read_log(command); // read the log, again when relaunched
+			else
+				error_list = bless_run_until(command, max_errors, isFirstUnit, &isStopped); // run the command
+			if (error_list == NULL)
+				quit_on_error(isLog ? "Cannot read the build log\n" : "Cannot run the command\n", 1);
+			row = bless_first_row(error_list, isPriority);
+
+
+			if (bless_nb_rows(error_list) == 0)
+			{
+				endwin();
+				unlink(session_path); // nothing left to resume
+				printf("The compiled program shows no error!\n");
+				exit(0);
+			}
 
-		message = "Launching : done";
+			bless_save_session(session_path, error_list, command, row);
+			sprintf(launch_msg, "Launching : %s, %d errors %d warnings", isStopped ? "stopped early" : "done",
+				bless_count_severity(error_list, BLESS_SEVERITY_ERROR)+bless_count_severity(error_list, BLESS_SEVERITY_FATAL),
+				bless_count_severity(error_list, BLESS_SEVERITY_WARNING));
+		}
+		message = launch_msg;
+		reset_prefetcher(prefetcher, error_list);
 
 		isRelaunch = FALSE; // the program will not relaunch if not told so
 		isOver = FALSE;
@@ -932,31 +771,76 @@ int main(int argc, char* argv[])
 				clear(); // clears the window
 
 			// display all info
-			display_error(node, error_list->size);
+			if (bless_nb_rows(error_list) > 0)
+				display_error(error_list, row);
+			else if (message == NULL)
+				message = "The shared build shows no error (r to relaunch)"; // only for a client
 			display_interface(MAIN_MENU);
 			display_message(message);
 
 			shouldClear = TRUE;
 			message = NULL;
 
-			c = getch();
+			if (bless_nb_rows(error_list) > 0)
+				prefetch_ahead(prefetcher, error_list, row, direction, isPriority); // while the user reads this error
+
+			if (conn != NULL)
+			{
+				BlessErrorList *displayed = error_list;
+				c = client_key(conn, &error_list, &row, &command, &message, launch_msg);
+				if (error_list != displayed)
+					reset_prefetcher(prefetcher, error_list); // relaunched by the daemon
+			}
+			else
+			{
+				c = getch();
+			}
+			if (bless_nb_rows(error_list) == 0 && c != 114 && c != 10 && c != 27 && c != ERR)
+				continue; // nothing to edit
 			switch (c)
 			{
 				case KEY_RIGHT:
-					if (node->next != NULL) node = node->next;
-					break;
 				case KEY_LEFT:
-					if (node->prev != NULL) node = node->prev;
+				{
+					direction = (c == KEY_RIGHT) ? 1 : -1;
+					int next = bless_next_row(error_list, row, direction, isPriority);
+					if (next >= 0) row = next;
+					break;
+				}
+				case 112: // letter 'p' for priority
+					isPriority = !isPriority;
+					if (isPriority)
+					{
+						BlessDiagnostic diag;
+						bless_diagnostic(error_list, row, &diag);
+						if (diag.cause >= 0) row = diag.cause; // go to the root of a cascade
+						message = "Root causes first, cascades folded";
+					}
+					else
+					{
+						message = "Errors in output order";
+					}
 					break;
 				case 105: // letter 'i' for imput
 					display_interface(INSERT_MENU);
-					hasEdit = edit(screen, node);
-					if (hasEdit)
+					if (edit(screen, error_list, row))
+					{
+						hasEdit = TRUE;
 						hasSaved = FALSE; // edited but not saved
+						if (conn != NULL)
+							share_row(conn, error_list, row);
+						else
+							bless_save_session(session_path, error_list, command, row); // keep the edit if the terminal is lost
+					}
 					break;
 
 				case 114: // letter 'r' for re-launch
-					if (hasSaved)
+					if (conn != NULL)
+					{
+						bless_send(conn, "RUN", 0, 0, NULL); // refused by the daemon if edits are not written
+						message = "Relaunch asked to the daemon";
+					}
+					else if (hasSaved)
 					{
 						display_message("Relaunching the command");
 						isOver = TRUE; // exit menu
@@ -969,19 +853,31 @@ int main(int argc, char* argv[])
 					break;
 
 				case 119: // letter 'w' for write
-					if (hasEdit)
+					if (conn != NULL)
+					{
+						bless_send(conn, "WRITE", 0, 0, NULL); // the edits of every client
+						message = "Write asked to the daemon";
+					}
+					else if (hasEdit)
 					{
+						int nb_stale = 0;
 						display_message("Beginning to write");
-						if (place_in_file(error_list))
+						if (bless_place_in_file(error_list, &nb_stale))
 						{
 							message ="ERROR IN WRITE !";
 						}
+						else if (nb_stale > 0)
+						{
+							sprintf(launch_msg, "%d lines changed on disk, not written (relaunch to refresh)", nb_stale);
+							message = launch_msg;
+						}
 						else
 						{
 							message = "Successful write !";
 						}
-						hasEdit = FALSE; // reset the edit flag
-						hasSaved = TRUE; // file(s) has been saved
+						hasEdit = (nb_stale > 0); // the refused edits are kept
+						hasSaved = !hasEdit; // file(s) has been saved
+						keep_session(session_path, error_list, command, row, hasEdit);
 					}
 					else
 					{
@@ -989,9 +885,157 @@ int main(int argc, char* argv[])
 					}
 					break;
 
+				case 117: // letter 'u' for undo
+				case 85: // letter 'U' for redo
+					if (bless_has_user_code(error_list, row) && (c == 117 ? bless_pt_undo(bless_row_piece_table(error_list, row))
+						: bless_pt_redo(bless_row_piece_table(error_list, row))))
+					{
+						bless_set_edited(error_list, row, TRUE); // differs from the last written version
+						hasEdit = TRUE;
+						hasSaved = FALSE;
+						message = (c == 117) ? "Undone" : "Redone";
+						if (conn != NULL)
+							share_row(conn, error_list, row);
+					}
+					else
+					{
+						message = (c == 117) ? "Nothing to undo" : "Nothing to redo";
+					}
+					break;
+
+				case 111: // letter 'o' for origin
+				{
+					char *current = bless_has_user_code(error_list, row) ? bless_pt_to_string(error_list, row) : NULL;
+					int isOrigin = (current == NULL || strcmp(current, bless_origin_code(error_list, row)) == 0);
+					free(current);
+					if (isOrigin)
+					{
+						message = "Already the original code";
+						break;
+					}
+					bless_pt_revert(error_list, row);
+					bless_set_edited(error_list, row, TRUE);
+					hasEdit = TRUE;
+					hasSaved = FALSE;
+					message = "Reverted to the original code (u to undo)";
+					if (conn != NULL)
+						share_row(conn, error_list, row);
+					break;
+				}
+
+				case 115: // letter 's' for substitute
+				{
+					char pattern[100];
+					char replacement[100];
+					char filter[100];
+					int nb_rows = 0;
+					int nb_files = 0;
+					prompt_string("Substitute (re: prefix for a regex) : ", pattern, sizeof(pattern));
+					prompt_string("With : ", replacement, sizeof(replacement));
+					prompt_string("In the errors containing (empty for all) : ", filter, sizeof(filter));
+
+					int isRegex = (strncmp(pattern, "re:", 3) == 0);
+					char *find = isRegex ? pattern+3 : pattern;
+					int nb_found = bless_substitute(error_list, find, isRegex, replacement, filter, FALSE, &nb_rows, &nb_files); // preview
+					if (nb_found < 0)
+					{
+						message = "Invalid pattern";
+						break;
+					}
+					if (nb_found == 0)
+					{
+						message = "No occurrence found";
+						break;
+					}
+
+					int nb_pending = 0;
+					for (int r=0; r<bless_nb_rows(error_list); r++)
+						nb_pending += bless_is_edited(error_list, r);
+					if (conn != NULL && nb_pending > 0) // the daemon writes every pending edit
+						sprintf(launch_msg, "%d occurrences in %d lines, write with %d unsaved lines ? Y/N", nb_found, nb_rows, nb_pending);
+					else
+						sprintf(launch_msg, "%d occurrences in %d lines of %d files, replace and write ? Y/N", nb_found, nb_rows, nb_files);
+					display_message(launch_msg);
+					int cc = getch();
+					if (cc != 89 && cc != 121) // 'Y' or 'y'
+					{
+						message = "Substitution cancelled";
+						break;
+					}
+
+					// the unsaved edits are set aside, so that only the substituted rows are written
+					int nb_rows_all = bless_nb_rows(error_list);
+					unsigned char *pending = malloc(nb_rows_all+1);
+					for (int r=0; r<nb_rows_all; r++)
+					{
+						pending[r] = bless_is_edited(error_list, r);
+						bless_set_edited(error_list, r, FALSE);
+					}
+					bless_substitute(error_list, find, isRegex, replacement, filter, TRUE, &nb_rows, &nb_files);
+					if (conn != NULL)
+					{
+						for (int r=0; r<nb_rows_all; r++)
+						{
+							if (bless_is_edited(error_list, r)) share_row(conn, error_list, r);
+							if (pending[r]) bless_set_edited(error_list, r, TRUE);
+						}
+						free(pending);
+						bless_send(conn, "WRITE", 0, 0, NULL);
+						message = "Substitution sent to the daemon";
+						break;
+					}
+					int *substituted = malloc((nb_rows_all+1)*sizeof(int));
+					int nb_substituted = 0;
+					for (int r=0; r<nb_rows_all; r++)
+						if (bless_is_edited(error_list, r)) substituted[nb_substituted++] = r;
+					int nb_stale = 0;
+					if (bless_place_in_file(error_list, &nb_stale))
+					{
+						message ="ERROR IN WRITE !";
+					}
+					else
+					{
+						sprintf(launch_msg, "%d occurrences replaced in %d files, %d stale lines refused", nb_found, nb_files, nb_stale);
+						message = launch_msg;
+					}
+					for (int j=0; j<nb_substituted; j++)
+						pending[substituted[j]] = FALSE; // written with its manual changes, or stale and still edited
+					hasEdit = FALSE;
+					for (int r=0; r<nb_rows_all; r++)
+					{
+						if (pending[r]) bless_set_edited(error_list, r, TRUE); // the other edits wait for the next write
+						hasEdit |= bless_is_edited(error_list, r);
+					}
+					free(substituted);
+					free(pending);
+					hasSaved = !hasEdit;
+					keep_session(session_path, error_list, command, row, hasEdit);
+					break;
+				}
+
+				case 102: // letter 'f' for fix-it
+				{
+					char filter[100];
+					int nb_applied = 0;
+					int nb_stale = 0;
+					prompt_string("Apply the fix-its of errors containing (empty for all) : ", filter, sizeof(filter));
+					if (conn != NULL)
+					{
+						bless_send(conn, "FIXIT", 0, 0, filter);
+						message = "Fix-its asked to the daemon";
+						break;
+					}
+					int isError = bless_apply_fixits(error_list, filter, &nb_applied, &nb_stale);
+					snprintf(launch_msg, sizeof(launch_msg), "%s%d fix-its applied, %d stale refused, relaunch to refresh",
+						isError ? "ERROR IN WRITE ! " : "", nb_applied, nb_stale);
+					message = launch_msg;
+					keep_session(session_path, error_list, command, row, hasEdit); // the fixed files show old errors
+					break;
+				}
+
 				case 10: // enter key
 				case 27: // Escape key
-					if (hasEdit)
+					if (hasEdit && conn == NULL) // a client's edits are kept by the daemon
 					{
 						display_message("Warning : edits have been made. Exit ? Y/N");
 						int cc = getch();
@@ -1013,6 +1057,13 @@ int main(int argc, char* argv[])
 				case 410: // resize
 					break;
 
+				case ERR: // terminal lost (hangup), keep everything for the next start
+					if (conn == NULL)
+						bless_save_session(session_path, error_list, command, row);
+					free(command);
+					bless_free_error_list(error_list);
+					exit(1);
+
 				default:
 					// no default behavior
 
@@ -1021,8 +1072,14 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	if (conn != NULL)
+		bless_disconnect(conn);
+	else
+		keep_session(session_path, error_list, command, row, hasEdit); // the pending edits are resumed by the next start
+
+	stop_prefetcher(prefetcher);
 	free(command);
-	free_error_list(error_list);
+	bless_free_error_list(error_list);
 
 
 	endwin(); // restore original window
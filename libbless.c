@@ -0,0 +1,3985 @@
+// libbless : parse the diagnostics of a build, keep the edits of their code lines and write them back
+// every function here works without a terminal, bless.c is the curses client
+#define _GNU_SOURCE // fopencookie, fmemopen
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <regex.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <zlib.h>
+#ifdef BLESS_ZSTD
+#include <zstd.h> // zstd logs, build with -DBLESS_ZSTD -lzstd
+#endif
+#include "libbless.h"
+
+#define TRUE 1
+#define FALSE 0
+
+#define CASCADE_WINDOW 10 // errors this many lines after a syntax error are likely caused by it
+
+#define OUTPUT_LINE_MAX 4096 // longest line of the command output read at once
+#define SNIFF_LINES 32 // output lines read from the first diagnostic to choose the parser backend
+
+#define TOOLCHAIN_RUSTC 0
+#define TOOLCHAIN_CLANG 1
+#define TOOLCHAIN_GCC 2 // gcc and g++, with the errors of the linker they drive
+#define TOOLCHAIN_LD 3
+
+#define LOG_RING_SIZE (1 << 20) // bytes of decompressed log buffered between the threads
+#define LOG_CHUNK 65536 // bytes of compressed log read at once
+#define LOG_PLAIN 0
+#define LOG_GZIP 1
+#define LOG_ZSTD 2
+
+#define SESSION_MAGIC "BLESSSES"
+#define SESSION_VERSION 5
+#define SESSION_BYTE_ORDER 0x01020304 // read back differently on a host of another endianness
+#define SESSION_MAX_SECTIONS 32
+
+#define DAEMON_CLIENTS 64 // clients served at once
+#define DAEMON_SAVE_DELAY 1000 // ms between an edit and the save of the shared session
+#define CONN_HEADER_MAX 64 // longest message header
+#define CONN_TEXT_MAX (1 << 24) // longest message text
+#define CONN_QUEUE_MAX (1 << 22) // bytes queued for a client that does not read, before it is dropped
+
+// Error holding columnar list
+
+typedef struct SparseColumn { // column that most rows leave at a default value, only the other rows are stored
+	int *rows; // stored rows, in insertion order
+	int *values; // value of each stored row
+	int size; // number of stored rows
+	int capacity; // allocated rows and values
+	int *buckets; // open addressing table holding index+1, 0 is an empty bucket
+	int nb_buckets; // number of buckets, a power of 2, 0 before the first row
+} SparseColumn;
+
+struct BlessErrorList { // struct of arrays, one row per line with errors
+	int size; // number of rows
+	int capacity; // number of allocated rows
+
+	// one column per field, indexed by row
+	int *line_nb; // line number
+	unsigned short *column; // column of the first error
+	int *file_id; // interned path to the file TODO : maybe split path and filename ?
+	int *function_id; // interned name of the function the code appears in
+	unsigned int *text_first; // index in text_offsets of the error messages, followed by the help lines
+	unsigned short *nb_msgs; // number of error messages
+	unsigned short *nb_help; // number of help lines
+	unsigned int *origin_code; // offset in text of the original code line
+	unsigned int *line_hash; // hash of the source line ignoring whitespace, 0 if unknown
+	unsigned char *severity; // worst severity of the messages
+	unsigned int *tu_first; // index in tu_ids of the translation units the error was reported from
+	unsigned short *nb_tus; // number of translation units
+	int *cause; // row of the likely root cause if the error is a cascade, -1 otherwise
+	int *rank; // position in the root causes, -1 for a cascade
+
+	// sparse columns, for the few rows away from the default
+	SparseColumn occurrences; // number of times the error was reported (e.g. from a shared header), 1 if not stored
+	SparseColumn nb_cascades; // number of errors folded under this one, 0 if not stored
+	SparseColumn edited; // rows with a piece table, valued by whether the code line changed since it was last written
+	struct BlessPieceTable **user_code; // user-modified code line of each row of edited, in the same order
+
+	// storage shared by all the rows
+	char *text; // every message, help and code line, null-terminated and packed together
+	unsigned int text_size; // used bytes of text
+	unsigned int text_capacity; // allocated bytes of text
+	unsigned int *text_offsets; // offset in text of the messages and help lines, grouped by row
+	int nb_texts; // number of messages and help lines
+	int *tu_ids; // interned translation units, grouped by row
+	int nb_tu_ids; // number of translation units
+	char *added; // every char typed by the user, append-only
+	unsigned int added_size; // used bytes of added
+	unsigned int added_capacity; // allocated bytes of added
+	struct StringPool *pool; // interned filenames and function names
+	int *ranked; // rows of the root causes, sorted by score
+	int nb_ranked; // number of root causes
+	struct FixIt *fixits; // fix-it hints, in output order
+	int nb_fixits; // number of fix-it hints
+	int fixits_capacity; // allocated fix-it hints
+	struct FileStamp *stamps; // size and modification time of the files at parse time, indexed by interned id
+	int nb_stamps; // number of stamps
+
+	void *mapping; // session file the columns point into, NULL when they are allocated
+	size_t mapping_size; // size of the mapping
+};
+
+
+
+// interned string pool
+
+typedef struct StringPool { // hash-based intern pool, each distinct string is stored once
+	char *text; // interned strings, null-terminated and packed together
+	unsigned int text_size; // used bytes of text
+	unsigned int text_capacity; // allocated bytes of text
+	unsigned int *offsets; // offset in text of each interned string, indexed by id
+	unsigned int *hashes; // hash of each interned string
+	int size; // number of interned strings
+	int capacity; // allocated slots in offsets and hashes
+	int *buckets; // open addressing table holding id+1, 0 is an empty bucket
+	int nb_buckets; // number of buckets, always a power of 2
+} StringPool;
+
+
+// fix-it hints and file patches
+
+typedef struct FixIt { // replacement suggested by the compiler (-fdiagnostics-parseable-fixits)
+	int row; // row of the error suggesting it
+	int file_id; // interned file to patch
+	int line_start; // line of the start of the replaced range
+	int col_start; // first replaced byte, from 1
+	int line_end; // line of the end of the replaced range
+	int col_end; // byte after the replaced range
+	unsigned int text; // offset of the replacement in the BlessErrorList text
+	int is_applied; // whether it has been written in the file
+} FixIt;
+
+
+// piece table of an edited code line
+
+typedef struct Piece { // span of the code line, taken from origin_code or from the added chars
+	unsigned int start; // offset of the span in its buffer
+	unsigned int len; // number of chars
+	int is_added; // 0 for origin_code, 1 for the BlessErrorList added chars
+} Piece;
+
+typedef struct PieceState { // a version of the line
+	Piece *pieces; // spans making the line, in order
+	int nb_pieces; // number of spans
+	int length; // number of chars in the line
+	int capacity; // allocated pieces
+} PieceState;
+
+struct BlessPieceTable { // edits of one code line, over its immutable origin_code
+	PieceState current; // line displayed and written
+	PieceState *undo; // previous versions, the last one is restored first
+	int nb_undo; // number of previous versions
+	PieceState *redo; // undone versions
+	int nb_redo; // number of undone versions
+};
+
+
+// shared session daemon
+
+struct BlessConnection { // buffered end of the daemon socket
+	int fd; // connected Unix socket
+	char *in; // received bytes
+	unsigned int in_start; // first byte of the next message in in
+	unsigned int in_size; // used bytes of in
+	unsigned int in_capacity; // allocated bytes of in
+	char *out; // bytes not sent yet, on the non-blocking sockets of the daemon
+	unsigned int out_start; // first byte of out to send
+	unsigned int out_size; // used bytes of out
+	unsigned int out_capacity; // allocated bytes of out
+};
+
+
+// diagnostic deduplication table
+
+typedef struct DiagEntry { // one distinct error message
+	unsigned int hash; // hash of (file, line, column, message)
+	int file_id; // interned file of the error
+	int line_nb; // line number of the error
+	int column; // column of the error
+	unsigned int msg; // offset of the message in the BlessErrorList text, 0 for an empty entry
+	int row; // row holding the message
+	int is_first; // whether this is the first message of its row
+} DiagEntry;
+
+
+typedef struct DiagTable { // open addressing hash set of the errors already parsed
+	DiagEntry *entries; // entries of the table
+	int size; // number of used entries
+	int nb_entries; // number of entries, always a power of 2
+} DiagTable;
+
+
+// file patches
+
+typedef struct Patch { // replacement of a range of a file
+	int file_id; // interned file to patch
+	int line_start; // line of the start of the replaced range
+	int col_start; // first replaced byte, from 1
+	int line_end; // line of the end of the replaced range
+	int col_end; // byte after the replaced range
+	char *text; // replacement
+	int fixit; // index of the fix-it the patch comes from, -1 for a user edit
+	int row; // row of the user edit, -1 for a fix-it
+	int is_applied; // whether the patch has been written
+	int is_stale; // refused because its line changed on disk
+} Patch;
+
+
+typedef struct FileStamp { // state of a file when its errors were parsed
+	long long size; // size in bytes, -1 if the file could not be read, -2 if no error is in it
+	long long mtime; // modification time in nanoseconds
+} FileStamp;
+
+
+// session file
+
+typedef struct SessionHeader { // start of a session file, every section is located by its offset from the start of the file
+	char magic[8]; // SESSION_MAGIC, not null-terminated
+	unsigned int version; // SESSION_VERSION
+	unsigned int byte_order; // SESSION_BYTE_ORDER
+	unsigned int size; // number of rows
+	unsigned int nb_texts; // number of messages and help lines
+	unsigned int nb_tu_ids; // number of translation units
+	unsigned int nb_ranked; // number of root causes
+	unsigned int nb_fixits; // number of fix-it hints
+	unsigned int text_size; // bytes of packed text
+	unsigned int pool_size; // number of interned strings
+	unsigned int pool_text_size; // bytes of interned strings
+	unsigned int nb_edits; // number of rows with a piece table
+	unsigned int edit_text_size; // bytes of user-modified code lines
+	unsigned int nb_repeated; // rows stored in the occurrences sparse column
+	unsigned int nb_folding; // rows stored in the nb_cascades sparse column
+	int current_row; // row displayed when the session was saved
+	unsigned long long sections[SESSION_MAX_SECTIONS]; // offset of each section
+	unsigned long long section_sizes[SESSION_MAX_SECTIONS]; // size of each section in bytes
+} SessionHeader;
+
+
+typedef struct SessionSection { // an array stored in a session file
+	void **data; // address of the pointer to the array
+	unsigned long long size; // size of the array in bytes
+} SessionSection;
+
+
+// parsed text waiting to be grouped by row
+
+typedef struct TextRef {
+	int row; // row the text belongs to
+	int is_help; // FALSE for an error message, TRUE for a help line
+	unsigned int offset; // offset of the text in the BlessErrorList text
+} TextRef;
+
+
+// path resolution
+
+typedef struct PathResolver { // canonical absolute paths of the diagnostics, one realpath per distinct directory
+	StringPool *dirs; // directories, as absolute paths joined from the output, then canonical ones
+	int *canonical; // id in dirs of the canonical form of each directory, -1 until resolved
+	int canonical_capacity; // allocated ids in canonical
+	int *stack; // directories entered by make, the last one is the current directory
+	int nb_stack; // number of entered directories
+	int stack_capacity; // allocated directories in stack
+	int cwd_id; // directory Bless runs in, current when make entered none
+	char last_path[OUTPUT_LINE_MAX]; // last path resolved, as written in the output
+	int last_len; // length of last_path, -1 before the first path
+	int last_dir; // directory last_path was relative to
+	int last_id; // interned canonical path of last_path
+} PathResolver;
+
+
+// output parsers
+
+typedef struct ParseState { // what the parser knows at the current output line
+	struct BlessErrorList *el; // errors parsed so far
+	int file_id; // interned name of the file where the error is
+	int function_id; // interned name of the function the error is
+	int tu_id; // interned translation unit being compiled
+	int row; // row receiving the lines read, -1 before the first error
+	int is_new_code; // whether the next source excerpt is the code line of the error
+	int is_ignored; // whether the lines being read belong to no new error (duplicate, or no location)
+	int is_linking; // whether the last lines came from the linker
+	int is_including; // whether the last line was an include chain, continued by "   from file:line"
+	PathResolver *paths; // directory of the compiler, for relative paths
+	struct DiagTable *seen; // errors already parsed, for deduplication
+	TextRef *refs; // messages and help lines in output order, grouped by row at the end
+	int nb_refs; // number of refs
+	int refs_capacity; // allocated refs
+	int *tu_pairs; // (row, translation unit) pairs in output order
+	int nb_tu_pairs; // number of pairs
+	int tu_pairs_capacity; // allocated pairs
+	char pending[OUTPUT_LINE_MAX]; // rustc message waiting for its location line
+	int has_pending; // whether pending holds a message
+	int max_errors; // errors captured before stopping, 0 to read everything
+	int isFirstUnit; // whether to stop once the first translation unit with errors is over
+	int nb_errors; // rows of severity error or fatal
+	int failed_tu; // translation unit of the first error, -1 before it
+	int is_full; // whether the capture ends with the current error
+	int is_stopped; // whether the rest of the output is not read
+} ParseState;
+
+
+typedef struct Toolchain { // parser backend
+	char *name; // compiler or linker
+	int (*sniff)(char **lines, int nb_lines); // whether the first output lines come from this toolchain
+	void (*parse)(ParseState *ps, FILE *p, char **lines, int nb_lines); // parse loop specialized for this toolchain
+} Toolchain;
+
+
+// streaming build log input
+
+typedef struct LogReader { // decompression thread feeding the parser through a bounded ring buffer
+	pthread_t thread; // decompression thread
+	pthread_mutex_t lock; // protects the positions and flags
+	pthread_cond_t can_read; // signaled when bytes are written or the log ends
+	pthread_cond_t can_write; // signaled when bytes are read or the reader is closed
+	char *ring; // LOG_RING_SIZE bytes
+	unsigned long long head; // bytes written since the start, ring[head % LOG_RING_SIZE] is the next one
+	unsigned long long tail; // bytes read since the start
+	int fd; // log file
+	int format; // LOG_PLAIN, LOG_GZIP or LOG_ZSTD
+	int is_over; // whether the whole log has been written
+	int is_closed; // whether the parser stopped reading
+} LogReader;
+
+
+
+// HELPER FUNCTIONS //
+
+
+static unsigned int hash_string(const char *str, int len)
+{
+	// FNV-1a hash of the len first chars of str
+	unsigned int hash = 2166136261u;
+	for (int i=0; i<len; i++)
+	{
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+static unsigned int code_hash(const char *str, long len)
+{
+	// FNV-1a hash of a code line ignoring whitespace, as gcc expands tabs in the lines it prints
+	// never 0, which stands for an unknown line
+	unsigned int hash = 2166136261u;
+	for (long i=0; i<len; i++)
+	{
+		if (isspace((unsigned char)str[i])) continue;
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return (hash == 0) ? 1 : hash;
+}
+
+
+static unsigned int blob_append(char **text, unsigned int *size, unsigned int *capacity, const char *str, int len)
+{
+	// copy the len first chars of str at the end of a packed text, return its offset
+	if (*size+len+1 > *capacity)
+	{
+		while (*size+len+1 > *capacity)
+			*capacity *= 2;
+		*text = realloc(*text, *capacity);
+	}
+	unsigned int offset = *size;
+	memcpy(*text+offset, str, len);
+	(*text)[offset+len] = '\0'; // null char
+	*size += len+1;
+	return offset;
+}
+
+
+static StringPool* new_string_pool()
+{
+	// create an empty intern pool
+	StringPool *pool = NULL;
+	pool = malloc(sizeof(StringPool));
+	pool->text_size = 0;
+	pool->text_capacity = 256;
+	pool->text = malloc(pool->text_capacity);
+	pool->size = 0;
+	pool->capacity = 16;
+	pool->offsets = malloc(pool->capacity*sizeof(unsigned int));
+	pool->hashes = malloc(pool->capacity*sizeof(unsigned int));
+	pool->nb_buckets = 32;
+	pool->buckets = calloc(pool->nb_buckets, sizeof(int));
+	return pool;
+}
+
+
+static void pool_grow(StringPool *pool)
+{
+	// double the number of buckets and rehash every interned string
+	free(pool->buckets);
+	pool->nb_buckets *= 2;
+	pool->buckets = calloc(pool->nb_buckets, sizeof(int));
+
+	for (int id=0; id<pool->size; id++)
+	{
+		unsigned int b = pool->hashes[id] & (pool->nb_buckets-1);
+		while (pool->buckets[b] != 0)
+			b = (b+1) & (pool->nb_buckets-1); // linear probing
+		pool->buckets[b] = id+1;
+	}
+}
+
+
+static int pool_intern(StringPool *pool, const char *str, int len)
+{
+	// return the id of the len first chars of str, adding them to the pool if needed
+	unsigned int hash = hash_string(str, len);
+	unsigned int b = hash & (pool->nb_buckets-1);
+
+	while (pool->buckets[b] != 0)
+	{
+		int id = pool->buckets[b]-1;
+		char *interned = pool->text+pool->offsets[id];
+		if (pool->hashes[id] == hash && strncmp(interned, str, len) == 0 && interned[len] == '\0')
+			return id; // already interned
+		b = (b+1) & (pool->nb_buckets-1);
+	}
+
+	if (pool->size == pool->capacity)
+	{
+		pool->capacity *= 2;
+		pool->offsets = realloc(pool->offsets, pool->capacity*sizeof(unsigned int));
+		pool->hashes = realloc(pool->hashes, pool->capacity*sizeof(unsigned int));
+	}
+
+	int id = pool->size++;
+	pool->offsets[id] = blob_append(&pool->text, &pool->text_size, &pool->text_capacity, str, len);
+	pool->hashes[id] = hash;
+	pool->buckets[b] = id+1;
+
+	if (pool->size*2 > pool->nb_buckets) // keep the load factor under 1/2
+		pool_grow(pool);
+
+	return id;
+}
+
+
+static char* pool_get(StringPool *pool, int id)
+{
+	// return the string interned under id, or an empty string for an unknown id
+	if (id < 0 || id >= pool->size)
+		return "";
+	return pool->text+pool->offsets[id];
+}
+
+
+static void free_string_pool(StringPool *pool)
+{
+	// free the pool and every interned string
+	free(pool->text);
+	free(pool->offsets);
+	free(pool->hashes);
+	free(pool->buckets);
+	free(pool);
+}
+
+
+// sparse columns
+
+static int sparse_find(SparseColumn *col, int row)
+{
+	// return the index of a stored row, -1 if the row has the default value
+	if (col->nb_buckets == 0)
+		return -1;
+	unsigned int b = ((unsigned int)row * 2654435761u) & (col->nb_buckets-1);
+	while (col->buckets[b] != 0)
+	{
+		if (col->rows[col->buckets[b]-1] == row)
+			return col->buckets[b]-1;
+		b = (b+1) & (col->nb_buckets-1); // linear probing
+	}
+	return -1;
+}
+
+
+static int sparse_get(SparseColumn *col, int row, int fallback)
+{
+	// value of a row, fallback if it is not stored
+	int i = sparse_find(col, row);
+	return (i < 0) ? fallback : col->values[i];
+}
+
+
+static void sparse_grow(SparseColumn *col)
+{
+	// double the number of buckets and rehash every stored row
+	free(col->buckets);
+	col->nb_buckets = (col->nb_buckets == 0) ? 16 : col->nb_buckets*2;
+	col->buckets = calloc(col->nb_buckets, sizeof(int));
+
+	for (int i=0; i<col->size; i++)
+	{
+		unsigned int b = ((unsigned int)col->rows[i] * 2654435761u) & (col->nb_buckets-1);
+		while (col->buckets[b] != 0)
+			b = (b+1) & (col->nb_buckets-1);
+		col->buckets[b] = i+1;
+	}
+}
+
+
+static int sparse_add(SparseColumn *col, int row, int initial)
+{
+	// return the index of a row, storing it with the initial value if needed
+	int i = sparse_find(col, row);
+	if (i >= 0)
+		return i;
+
+	if (col->size == col->capacity)
+	{
+		col->capacity = (col->capacity == 0) ? 8 : col->capacity*2;
+		col->rows = realloc(col->rows, col->capacity*sizeof(int));
+		col->values = realloc(col->values, col->capacity*sizeof(int));
+	}
+	i = col->size++;
+	col->rows[i] = row;
+	col->values[i] = initial;
+
+	if (col->size*2 > col->nb_buckets) // keep the load factor under 1/2, rehashing places the new row
+		sparse_grow(col);
+	else
+	{
+		unsigned int b = ((unsigned int)row * 2654435761u) & (col->nb_buckets-1);
+		while (col->buckets[b] != 0)
+			b = (b+1) & (col->nb_buckets-1);
+		col->buckets[b] = i+1;
+	}
+	return i;
+}
+
+
+static void free_sparse_column(SparseColumn *col)
+{
+	free(col->rows);
+	free(col->values);
+	free(col->buckets);
+}
+
+
+static DiagTable* new_diag_table()
+{
+	// create an empty deduplication table
+	DiagTable *table = NULL;
+	table = malloc(sizeof(DiagTable));
+	table->size = 0;
+	table->nb_entries = 64;
+	table->entries = calloc(table->nb_entries, sizeof(DiagEntry));
+	return table;
+}
+
+
+static unsigned int diag_hash(int file_id, int line_nb, int column, char *msg)
+{
+	// hash the key of an error message
+	unsigned int hash = hash_string(msg, strlen(msg));
+	hash ^= (unsigned int)file_id * 2654435761u;
+	hash ^= (unsigned int)line_nb * 2246822519u;
+	hash ^= (unsigned int)column * 3266489917u;
+	return hash;
+}
+
+
+static DiagEntry* diag_find(DiagTable *table, char *text, int file_id, int line_nb, int column, char *msg)
+{
+	// return the entry of an identical error already parsed, or NULL
+	unsigned int hash = diag_hash(file_id, line_nb, column, msg);
+	unsigned int b = hash & (table->nb_entries-1);
+
+	while (table->entries[b].msg != 0)
+	{
+		DiagEntry *entry = &table->entries[b];
+		if (entry->hash == hash && entry->file_id == file_id && entry->line_nb == line_nb
+			&& entry->column == column && strcmp(text+entry->msg, msg) == 0)
+			return entry;
+		b = (b+1) & (table->nb_entries-1); // linear probing
+	}
+	return NULL;
+}
+
+
+static void diag_insert(DiagTable *table, char *text, int file_id, int line_nb, int column, int row, unsigned int msg, int is_first)
+{
+	// add a new error message to the table
+	if ((table->size+1)*2 > table->nb_entries)
+	{
+		// keep the load factor under 1/2
+		DiagEntry *old = table->entries;
+		int nb_old = table->nb_entries;
+		table->nb_entries *= 2;
+		table->entries = calloc(table->nb_entries, sizeof(DiagEntry));
+		for (int i=0; i<nb_old; i++)
+		{
+			if (old[i].msg == 0) continue;
+			unsigned int b = old[i].hash & (table->nb_entries-1);
+			while (table->entries[b].msg != 0)
+				b = (b+1) & (table->nb_entries-1);
+			table->entries[b] = old[i];
+		}
+		free(old);
+	}
+
+	unsigned int hash = diag_hash(file_id, line_nb, column, text+msg);
+	unsigned int b = hash & (table->nb_entries-1);
+	while (table->entries[b].msg != 0)
+		b = (b+1) & (table->nb_entries-1);
+
+	DiagEntry *entry = &table->entries[b];
+	entry->hash = hash;
+	entry->file_id = file_id;
+	entry->line_nb = line_nb;
+	entry->column = column;
+	entry->msg = msg;
+	entry->row = row;
+	entry->is_first = is_first;
+	table->size += 1;
+}
+
+
+static void free_diag_table(DiagTable *table)
+{
+	// free the table, the messages it points to are left untouched
+	free(table->entries);
+	free(table);
+}
+
+
+static BlessErrorList* new_error_list()
+{
+	// create an empty error list
+	BlessErrorList *el = NULL;
+	el = calloc(1, sizeof(BlessErrorList)); // every column starts NULL
+	el->text_capacity = 4096;
+	el->text = malloc(el->text_capacity);
+	blob_append(&el->text, &el->text_size, &el->text_capacity, "", 0); // offset 0 is the empty string
+	el->added_capacity = 256;
+	el->added = malloc(el->added_capacity);
+	el->pool = new_string_pool();
+	return el;
+}
+
+
+static int add_row(BlessErrorList *el)
+{
+	// append an empty row to the list and return its index
+	if (el->size == el->capacity)
+	{
+		el->capacity = (el->capacity == 0) ? 64 : el->capacity*2;
+		el->line_nb = realloc(el->line_nb, el->capacity*sizeof(int));
+		el->column = realloc(el->column, el->capacity*sizeof(unsigned short));
+		el->file_id = realloc(el->file_id, el->capacity*sizeof(int));
+		el->function_id = realloc(el->function_id, el->capacity*sizeof(int));
+		el->text_first = realloc(el->text_first, el->capacity*sizeof(unsigned int));
+		el->nb_msgs = realloc(el->nb_msgs, el->capacity*sizeof(unsigned short));
+		el->nb_help = realloc(el->nb_help, el->capacity*sizeof(unsigned short));
+		el->origin_code = realloc(el->origin_code, el->capacity*sizeof(unsigned int));
+		el->line_hash = realloc(el->line_hash, el->capacity*sizeof(unsigned int));
+		el->severity = realloc(el->severity, el->capacity*sizeof(unsigned char));
+		el->tu_first = realloc(el->tu_first, el->capacity*sizeof(unsigned int));
+		el->nb_tus = realloc(el->nb_tus, el->capacity*sizeof(unsigned short));
+		el->cause = realloc(el->cause, el->capacity*sizeof(int));
+		el->rank = realloc(el->rank, el->capacity*sizeof(int));
+	}
+
+	int row = el->size++;
+	el->line_nb[row] = -1;
+	el->column[row] = 0;
+	el->file_id[row] = -1;
+	el->function_id[row] = -1;
+	el->text_first[row] = 0;
+	el->nb_msgs[row] = 0;
+	el->nb_help[row] = 0;
+	el->origin_code[row] = 0; // empty until the code line is read
+	el->line_hash[row] = 0;
+	el->severity[row] = 0;
+	el->tu_first[row] = 0;
+	el->nb_tus[row] = 0;
+	el->cause[row] = -1;
+	el->rank[row] = -1;
+	return row;
+}
+
+
+static unsigned int add_text(BlessErrorList *el, const char *str, int len)
+{
+	// pack the len first chars of str in the text of the list, return its offset
+	return blob_append(&el->text, &el->text_size, &el->text_capacity, str, len);
+}
+
+
+char* bless_error_msg(BlessErrorList *el, int row, int i)
+{
+	// return the i-th error message of a row
+	return el->text+el->text_offsets[el->text_first[row]+i];
+}
+
+
+char* bless_help_line(BlessErrorList *el, int row, int i)
+{
+	// return the i-th help line of a row
+	return el->text+el->text_offsets[el->text_first[row]+el->nb_msgs[row]+i];
+}
+
+
+char* bless_origin_code(BlessErrorList *el, int row)
+{
+	// return the original code line of a row
+	return el->text+el->origin_code[row];
+}
+
+
+static BlessPieceTable* new_piece_table(BlessErrorList *el, int row)
+{
+	// create the piece table of a row, holding its whole origin_code
+	BlessPieceTable *pt = calloc(1, sizeof(BlessPieceTable));
+	pt->current.capacity = 4;
+	pt->current.pieces = malloc(pt->current.capacity*sizeof(Piece));
+	pt->current.length = strlen(bless_origin_code(el, row));
+	if (pt->current.length > 0)
+	{
+		pt->current.pieces[0].start = 0;
+		pt->current.pieces[0].len = pt->current.length;
+		pt->current.pieces[0].is_added = FALSE;
+		pt->current.nb_pieces = 1;
+	}
+	return pt;
+}
+
+
+static void free_piece_table(BlessPieceTable *pt)
+{
+	// free the table and its history, the text itself belongs to the BlessErrorList
+	free(pt->current.pieces);
+	for (int i=0; i<pt->nb_undo; i++)
+		free(pt->undo[i].pieces);
+	for (int i=0; i<pt->nb_redo; i++)
+		free(pt->redo[i].pieces);
+	free(pt->undo);
+	free(pt->redo);
+	free(pt);
+}
+
+
+static void pt_push(PieceState **stack, int *nb, PieceState state)
+{
+	// push a version on an undo/redo stack
+	*stack = realloc(*stack, (*nb+1)*sizeof(PieceState));
+	(*stack)[(*nb)++] = state;
+}
+
+
+void bless_pt_begin_change(BlessPieceTable *pt)
+{
+	// keep the current version for undo before modifying it, the redo history is dropped
+	PieceState saved = pt->current;
+	saved.capacity = saved.nb_pieces+1;
+	saved.pieces = malloc(saved.capacity*sizeof(Piece));
+	memcpy(saved.pieces, pt->current.pieces, saved.nb_pieces*sizeof(Piece)); // only the spans, never the text
+	pt_push(&pt->undo, &pt->nb_undo, saved);
+
+	for (int i=0; i<pt->nb_redo; i++)
+		free(pt->redo[i].pieces);
+	pt->nb_redo = 0;
+}
+
+
+static int pt_split(BlessPieceTable *pt, int pos)
+{
+	// make pos the start of a piece, return the index of that piece
+	int offset = 0;
+	for (int i=0; i<pt->current.nb_pieces; i++)
+	{
+		Piece *piece = &pt->current.pieces[i];
+		if (pos == offset)
+			return i;
+		if (pos < offset+(int)piece->len)
+		{
+			// cut the piece in two
+			if (pt->current.nb_pieces == pt->current.capacity)
+			{
+				pt->current.capacity *= 2;
+				pt->current.pieces = realloc(pt->current.pieces, pt->current.capacity*sizeof(Piece));
+				piece = &pt->current.pieces[i];
+			}
+			memmove(piece+1, piece, (pt->current.nb_pieces-i)*sizeof(Piece));
+			piece[0].len = pos-offset;
+			piece[1].start += pos-offset;
+			piece[1].len -= pos-offset;
+			pt->current.nb_pieces++;
+			return i+1;
+		}
+		offset += piece->len;
+	}
+	return pt->current.nb_pieces; // end of the line
+}
+
+
+void bless_pt_insert(BlessErrorList *el, BlessPieceTable *pt, int pos, char chr)
+{
+	// insert a char at pos, the char is appended to the added chars
+	unsigned int start = blob_append(&el->added, &el->added_size, &el->added_capacity, &chr, 1);
+	el->added_size--; // no null char between typed chars
+	int i = pt_split(pt, pos);
+
+	Piece *prev = (i > 0) ? &pt->current.pieces[i-1] : NULL;
+	if (prev != NULL && prev->is_added && prev->start+prev->len == start)
+	{
+		prev->len += 1; // typing goes on, grow the last added piece
+	}
+	else
+	{
+		if (pt->current.nb_pieces == pt->current.capacity)
+		{
+			pt->current.capacity *= 2;
+			pt->current.pieces = realloc(pt->current.pieces, pt->current.capacity*sizeof(Piece));
+		}
+		Piece *piece = &pt->current.pieces[i];
+		memmove(piece+1, piece, (pt->current.nb_pieces-i)*sizeof(Piece));
+		piece->start = start;
+		piece->len = 1;
+		piece->is_added = TRUE;
+		pt->current.nb_pieces++;
+	}
+	pt->current.length++;
+}
+
+
+void bless_pt_delete(BlessPieceTable *pt, int pos)
+{
+	// delete the char at pos
+	if (pos < 0 || pos >= pt->current.length)
+		return;
+	pt_split(pt, pos+1);
+	int i = pt_split(pt, pos);
+	Piece *piece = &pt->current.pieces[i];
+	memmove(piece, piece+1, (pt->current.nb_pieces-i-1)*sizeof(Piece)); // the 1-char piece goes away
+	pt->current.nb_pieces--;
+	pt->current.length--;
+}
+
+
+void bless_pt_set_text(BlessErrorList *el, BlessPieceTable *pt, char *str)
+{
+	// replace the whole line (substitution, resumed session)
+	int len = strlen(str);
+	pt->current.nb_pieces = 0;
+	pt->current.length = len;
+	if (len > 0)
+	{
+		pt->current.pieces[0].start = blob_append(&el->added, &el->added_size, &el->added_capacity, str, len);
+		pt->current.pieces[0].len = len;
+		pt->current.pieces[0].is_added = TRUE;
+		pt->current.nb_pieces = 1;
+	}
+}
+
+
+int bless_pt_undo(BlessPieceTable *pt)
+{
+	// go back to the previous version, returns FALSE if there is none
+	if (pt->nb_undo == 0)
+		return FALSE;
+	pt_push(&pt->redo, &pt->nb_redo, pt->current);
+	pt->current = pt->undo[--pt->nb_undo];
+	return TRUE;
+}
+
+
+int bless_pt_redo(BlessPieceTable *pt)
+{
+	// go forward to the last undone version, returns FALSE if there is none
+	if (pt->nb_redo == 0)
+		return FALSE;
+	pt_push(&pt->undo, &pt->nb_undo, pt->current);
+	pt->current = pt->redo[--pt->nb_redo];
+	return TRUE;
+}
+
+
+void bless_pt_revert(BlessErrorList *el, int row)
+{
+	// go back to origin_code in O(1) : the current pieces are moved to the undo history, not copied
+	BlessPieceTable *pt = bless_row_piece_table(el, row);
+	int origin_len = strlen(bless_origin_code(el, row));
+	for (int i=0; i<pt->nb_redo; i++)
+		free(pt->redo[i].pieces);
+	pt->nb_redo = 0;
+	pt_push(&pt->undo, &pt->nb_undo, pt->current);
+
+	pt->current.pieces = malloc(2*sizeof(Piece));
+	pt->current.capacity = 2;
+	pt->current.nb_pieces = (origin_len > 0);
+	pt->current.length = origin_len;
+	pt->current.pieces[0].start = 0;
+	pt->current.pieces[0].len = origin_len;
+	pt->current.pieces[0].is_added = FALSE;
+}
+
+
+char* bless_pt_to_string(BlessErrorList *el, int row)
+{
+	// return the code line of a row as a new string, edited or not
+	int edit = sparse_find(&el->edited, row);
+	char *origin = bless_origin_code(el, row);
+	if (edit < 0)
+		return strdup(origin);
+
+	BlessPieceTable *pt = el->user_code[edit];
+
+	char *str = malloc(pt->current.length+1);
+	int len = 0;
+	for (int i=0; i<pt->current.nb_pieces; i++)
+	{
+		Piece *piece = &pt->current.pieces[i];
+		memcpy(str+len, (piece->is_added ? el->added : origin)+piece->start, piece->len);
+		len += piece->len;
+	}
+	str[len] = '\0'; // null-terminated
+	return str;
+}
+
+
+BlessPieceTable* bless_row_piece_table(BlessErrorList *el, int row)
+{
+	// return the piece table of a row, creating it on its first edit
+	int i = sparse_find(&el->edited, row);
+	if (i < 0)
+	{
+		i = sparse_add(&el->edited, row, FALSE);
+		el->user_code = realloc(el->user_code, el->edited.capacity*sizeof(BlessPieceTable*));
+		el->user_code[i] = new_piece_table(el, row);
+	}
+	return el->user_code[i];
+}
+
+
+int bless_count_severity(BlessErrorList *el, int severity)
+{
+	// number of rows of the given severity, a sequential scan of one column
+	int count = 0;
+	for (int row=0; row<el->size; row++)
+		count += (el->severity[row] == severity);
+	return count;
+}
+
+
+static void group_by_row(BlessErrorList *el, TextRef *refs, int nb_refs, int *tu_pairs, int nb_tu_pairs)
+{
+	// store the texts and translation units read in output order contiguously for each row
+	// (counting sort on the row, messages before help lines, translation units without repeats)
+	unsigned int *next_msg = calloc(el->size+1, sizeof(unsigned int));
+	unsigned int *next_help = malloc((el->size+1)*sizeof(unsigned int));
+
+	for (int i=0; i<nb_refs; i++)
+	{
+		if (refs[i].is_help)
+			el->nb_help[refs[i].row] += 1;
+		else
+			el->nb_msgs[refs[i].row] += 1;
+	}
+	unsigned int first = 0;
+	for (int row=0; row<el->size; row++)
+	{
+		el->text_first[row] = first;
+		next_msg[row] = first;
+		next_help[row] = first+el->nb_msgs[row];
+		first += el->nb_msgs[row]+el->nb_help[row];
+	}
+
+	el->nb_texts = nb_refs;
+	el->text_offsets = malloc((nb_refs+1)*sizeof(unsigned int));
+	for (int i=0; i<nb_refs; i++)
+	{
+		if (refs[i].is_help)
+			el->text_offsets[next_help[refs[i].row]++] = refs[i].offset;
+		else
+			el->text_offsets[next_msg[refs[i].row]++] = refs[i].offset;
+	}
+
+	// same for the (row, translation unit) pairs
+	memset(next_msg, 0, (el->size+1)*sizeof(unsigned int));
+	for (int i=0; i<nb_tu_pairs; i++)
+		next_msg[tu_pairs[2*i]] += 1;
+	first = 0;
+	for (int row=0; row<el->size; row++)
+	{
+		unsigned int count = next_msg[row];
+		el->tu_first[row] = first;
+		next_msg[row] = first;
+		first += count;
+	}
+	el->tu_ids = malloc((nb_tu_pairs+1)*sizeof(int));
+	for (int i=0; i<nb_tu_pairs; i++)
+	{
+		int row = tu_pairs[2*i];
+		int tu = tu_pairs[2*i+1];
+		int is_known = FALSE;
+		for (unsigned int j=el->tu_first[row]; j<next_msg[row]; j++)
+			is_known |= (el->tu_ids[j] == tu);
+		if (!is_known)
+			el->tu_ids[next_msg[row]++] = tu;
+	}
+	// packed without the slots of the duplicates, nothing uninitialized is saved in a session
+	unsigned int nb_tu_ids = 0;
+	for (int row=0; row<el->size; row++)
+	{
+		unsigned int start = el->tu_first[row];
+		el->nb_tus[row] = next_msg[row]-start;
+		el->tu_first[row] = nb_tu_ids;
+		for (unsigned int j=start; j<next_msg[row]; j++)
+			el->tu_ids[nb_tu_ids++] = el->tu_ids[j];
+	}
+	el->nb_tu_ids = nb_tu_ids;
+
+	free(next_msg);
+	free(next_help);
+}
+
+
+void bless_free_error_list(BlessErrorList *error_list)
+{
+	// completely free an error list and its member
+	for (int i=0; i<error_list->edited.size; i++)
+		free_piece_table(error_list->user_code[i]);
+	free(error_list->user_code);
+	free_sparse_column(&error_list->edited);
+	free_sparse_column(&error_list->occurrences);
+	free_sparse_column(&error_list->nb_cascades);
+	free(error_list->added);
+
+	if (error_list->mapping != NULL)
+	{
+		// the columns live in a mapped session file
+		munmap(error_list->mapping, error_list->mapping_size);
+		free_string_pool(error_list->pool);
+		free(error_list);
+		return;
+	}
+
+	free(error_list->line_nb);
+	free(error_list->column);
+	free(error_list->file_id);
+	free(error_list->function_id);
+	free(error_list->text_first);
+	free(error_list->nb_msgs);
+	free(error_list->nb_help);
+	free(error_list->origin_code);
+	free(error_list->line_hash);
+	free(error_list->severity);
+	free(error_list->tu_first);
+	free(error_list->nb_tus);
+	free(error_list->cause);
+	free(error_list->rank);
+
+	free(error_list->text);
+	free(error_list->text_offsets);
+	free(error_list->fixits);
+	free(error_list->stamps);
+	free(error_list->tu_ids);
+	free_string_pool(error_list->pool);
+	free(error_list->ranked);
+	free(error_list);
+}
+
+
+static long long stat_mtime(struct stat *st)
+{
+	// modification time of a file in nanoseconds
+	return (long long)st->st_mtim.tv_sec*1000000000LL + st->st_mtim.tv_nsec;
+}
+
+
+static void stamp_files(BlessErrorList *el)
+{
+	// record the size and modification time of every file holding an error or a fix-it, one stat per file
+	el->nb_stamps = el->pool->size;
+	el->stamps = malloc((el->nb_stamps+1)*sizeof(FileStamp));
+	for (int id=0; id<el->nb_stamps; id++)
+		el->stamps[id].size = -2; // interned name, but not a file to patch
+
+	for (int i=0; i<el->size+el->nb_fixits; i++)
+	{
+		int id = (i < el->size) ? el->file_id[i] : el->fixits[i-el->size].file_id;
+		if (id < 0 || el->stamps[id].size != -2) continue; // no file or already stamped
+
+		struct stat st;
+		if (stat(pool_get(el->pool, id), &st) == 0)
+		{
+			el->stamps[id].size = st.st_size;
+			el->stamps[id].mtime = stat_mtime(&st);
+		}
+		else
+		{
+			el->stamps[id].size = -1; // every write will check the line hashes
+		}
+	}
+}
+
+
+// PARSER AND PATCHER //
+
+
+static int message_severity(char *msg)
+{
+	// return the severity of an error message, from its "error:"/"warning:"/... prefix
+	if (strncmp(msg, "fatal error:", 12) == 0)
+		return BLESS_SEVERITY_FATAL;
+	if (strncmp(msg, "error:", 6) == 0 || strncmp(msg, "error[", 6) == 0) // rustc adds the error code
+		return BLESS_SEVERITY_ERROR;
+	if (strncmp(msg, "warning:", 8) == 0 || strncmp(msg, "warning[", 8) == 0)
+		return BLESS_SEVERITY_WARNING;
+	return BLESS_SEVERITY_NOTE;
+}
+
+
+static int cascade_identifier(char *msg, StringPool *idents)
+{
+	// return the interned identifier of an error that is only worth fixing once
+	// ("'x' undeclared", "implicit declaration of function 'x'"), or -1
+	char *start = NULL;
+	char *end = NULL;
+	char *pos = strstr(msg, " undeclared");
+
+	if (pos != NULL)
+	{
+		// identifier is before, between quotes (ascii or utf-8)
+		end = pos;
+		while (end > msg && !(end[-1] == '_' || isalnum((unsigned char)end[-1])))
+			end--;
+		start = end;
+		while (start > msg && (start[-1] == '_' || isalnum((unsigned char)start[-1])))
+			start--;
+	}
+	else if ((pos = strstr(msg, "implicit declaration of function ")) != NULL)
+	{
+		// identifier is after, between quotes (ascii or utf-8)
+		start = pos+33;
+		while (*start != '\0' && !(*start == '_' || isalnum((unsigned char)*start)))
+			start++;
+		end = start;
+		while (*end == '_' || isalnum((unsigned char)*end))
+			end++;
+	}
+
+	if (start == NULL || start == end)
+		return -1;
+	return pool_intern(idents, start, end-start);
+}
+
+
+typedef struct RankItem { // a root cause being sorted
+	int score; // likelihood of being a root cause, higher is visited first
+	int row; // row of the root cause
+} RankItem;
+
+
+static int compare_score(const void *a, const void *b)
+{
+	// order root causes by decreasing score, then by output order
+	RankItem *ra = (RankItem*)a;
+	RankItem *rb = (RankItem*)b;
+	if (ra->score != rb->score)
+		return rb->score - ra->score;
+	return ra->row - rb->row;
+}
+
+
+static void rank_errors(BlessErrorList *el)
+{
+	// score every error, fold the likely cascades under their cause and sort the root causes
+	int *tu_errors = calloc(el->pool->size, sizeof(int)); // number of errors already seen per translation unit
+	StringPool *idents = new_string_pool(); // identifiers of the "reported once" errors
+	int *first_use = NULL; // first error reported for each identifier
+	int syntax = -1; // row of the last syntax error ("expected ...")
+	RankItem *items = malloc((el->size+1)*sizeof(RankItem));
+	int nb_items = 0;
+
+	for (int row=0; row<el->size; row++)
+	{
+		char *msg = bless_error_msg(el, row, 0);
+		int tu = (el->nb_tus[row] > 0) ? el->tu_ids[el->tu_first[row]] : -1;
+		int score;
+
+		// severity first, then the earliest errors of their translation unit
+		score = el->severity[row]*100;
+		if (el->severity[row] >= BLESS_SEVERITY_ERROR && tu >= 0)
+		{
+			int position = tu_errors[tu]++;
+			if (position < 10)
+				score += 50-5*position;
+		}
+
+		// errors following a syntax error in the same function, or a few lines after it when the function is unknown
+		int isSameFunction = FALSE;
+		if (syntax >= 0 && (el->function_id[row] < 0 || el->function_id[syntax] < 0))
+			isSameFunction = (el->line_nb[row] - el->line_nb[syntax] <= CASCADE_WINDOW);
+		else if (syntax >= 0)
+			isSameFunction = (el->function_id[row] == el->function_id[syntax]); // never across a function change
+		if (syntax >= 0 && el->severity[row] >= BLESS_SEVERITY_ERROR && el->file_id[row] == el->file_id[syntax]
+			&& isSameFunction && el->line_nb[row] >= el->line_nb[syntax])
+		{
+			el->cause[row] = syntax;
+		}
+		else if (strncmp(msg, "error: expected ", 16) == 0)
+		{
+			syntax = row;
+			score += 30; // a syntax error usually hides the real code
+		}
+
+		// identifiers already reported elsewhere
+		int nb_known = idents->size;
+		int ident = cascade_identifier(msg, idents);
+		if (ident >= nb_known)
+		{
+			// first report of this identifier
+			first_use = realloc(first_use, idents->size*sizeof(int));
+			first_use[ident] = row;
+		}
+		else if (ident >= 0 && el->cause[row] < 0)
+		{
+			el->cause[row] = first_use[ident];
+		}
+
+		if (el->cause[row] >= 0)
+		{
+			while (el->cause[el->cause[row]] >= 0) // fold under the real root
+				el->cause[row] = el->cause[el->cause[row]];
+			int i = sparse_add(&el->nb_cascades, el->cause[row], 0); // may move values
+			el->nb_cascades.values[i] += 1;
+		}
+		else
+		{
+			items[nb_items].score = score;
+			items[nb_items].row = row;
+			nb_items++;
+		}
+	}
+
+	// sort the root causes
+	qsort(items, nb_items, sizeof(RankItem), compare_score);
+	free(el->ranked);
+	el->ranked = malloc((nb_items+1)*sizeof(int));
+	el->nb_ranked = nb_items;
+	for (int i=0; i<nb_items; i++)
+	{
+		el->ranked[i] = items[i].row;
+		el->rank[items[i].row] = i;
+	}
+
+	free(items);
+	free(first_use);
+	free_string_pool(idents);
+	free(tu_errors);
+}
+
+
+static int unescape_fixit(char *src, char *dest)
+{
+	// copy the escaped replacement of a fix-it line until its closing quote, return its length
+	int len = 0;
+	while (*src != '\0' && *src != '"')
+	{
+		if (*src == '\\' && src[1] != '\0')
+		{
+			src++;
+			switch (*src)
+			{
+				case 'n': dest[len++] = '\n'; src++; break;
+				case 't': dest[len++] = '\t'; src++; break;
+				case '0': case '1': case '2': case '3':
+				{
+					// octal escape, up to 3 digits
+					int value = 0;
+					for (int i=0; i<3 && *src >= '0' && *src <= '7'; i++)
+						value = value*8 + (*src++ - '0');
+					dest[len++] = value;
+					break;
+				}
+				default: dest[len++] = *src++; break; // \\ and \"
+			}
+		}
+		else
+		{
+			dest[len++] = *src++;
+		}
+	}
+	dest[len] = '\0';
+	return len;
+}
+
+
+static char* match_location(char *line, int *path_len, int *line_nb, int *column)
+{
+	// "path:line:column: rest" or "path:line: rest", returns rest or NULL
+	char *pos = line;
+	while (*pos != ':' && *pos != '\0' && !isspace((unsigned char)*pos))
+		pos++;
+	if (*pos != ':' || pos == line || !isdigit((unsigned char)pos[1]))
+		return NULL;
+	*path_len = pos-line;
+	*line_nb = strtol(pos+1, &pos, 10);
+	*column = 0;
+	if (*pos != ':')
+		return NULL;
+	pos++;
+	if (isdigit((unsigned char)*pos))
+	{
+		*column = strtol(pos, &pos, 10);
+		if (*pos == ':')
+			pos++;
+		else if (*pos != '\n' && *pos != '\0') // rustc locations end the line
+			return NULL;
+	}
+	if (*pos == ' ')
+		pos++;
+	return pos;
+}
+
+
+static char* match_gutter(char *line, int *code_line)
+{
+	// source excerpt line, "  12 | code" (code_line 12) or "     | ^~~~" and "  +++ |+fix" (code_line -1)
+	// returns the text after the gutter or NULL
+	char *pos = line;
+	while (*pos == ' ')
+		pos++;
+	char *token = pos;
+	int is_number = TRUE;
+	while (*pos != ' ' && *pos != '|' && *pos != '\n' && *pos != '\0')
+	{
+		is_number &= (isdigit((unsigned char)*pos) != 0);
+		pos++;
+	}
+	while (*pos == ' ')
+		pos++;
+	if (*pos != '|')
+		return NULL;
+	*code_line = (is_number && pos > token) ? atoi(token) : -1;
+	pos++;
+	if (*pos != '\n' && *pos != '\0')
+		pos++; // space, or '+' of an added line
+	return pos;
+}
+
+
+static int is_source_path(char *path, int len)
+{
+	// whether a file is compiled by itself (a.c, a.cpp, a.rs...) rather than included (a.h, a.hpp, a.inl...)
+	char *ext = NULL;
+	for (int i=len-1; i >= 0 && path[i] != '/'; i--)
+	{
+		if (path[i] == '.')
+		{
+			ext = path+i+1;
+			break;
+		}
+	}
+	if (ext == NULL || ext == path+len)
+		return FALSE;
+	int ext_len = path+len-ext;
+	if (ext[0] == 'h' || ext[0] == 'H')
+		return FALSE;
+	if (ext_len == 3 && (strncmp(ext, "inl", 3) == 0 || strncmp(ext, "tcc", 3) == 0 || strncmp(ext, "ipp", 3) == 0))
+		return FALSE;
+	return TRUE;
+}
+
+
+static int is_linker_path(char *path, int len)
+{
+	// whether a program name is GNU ld or one of its variants (/usr/bin/ld, ld.gold, x86_64-linux-gnu-ld.bfd...)
+	char *name = path;
+	for (int i=0; i<len; i++)
+	{
+		if (path[i] == '/')
+			name = path+i+1;
+	}
+	int name_len = path+len-name;
+	if (name_len == 2 && strncmp(name, "ld", 2) == 0)
+		return TRUE;
+	if (name_len > 3 && strncmp(name, "ld.", 3) == 0)
+		return TRUE;
+	if (name_len > 3 && strncmp(name+name_len-3, "-ld", 3) == 0)
+		return TRUE;
+	for (int i=0; i+4 <= name_len; i++)
+	{
+		if (strncmp(name+i, "-ld.", 4) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static void add_ref(ParseState *ps, int is_help, unsigned int offset)
+{
+	// record a message or help line of the current row, in output order
+	if (ps->nb_refs == ps->refs_capacity)
+	{
+		ps->refs_capacity *= 2;
+		ps->refs = realloc(ps->refs, ps->refs_capacity*sizeof(TextRef));
+	}
+	ps->refs[ps->nb_refs].row = ps->row;
+	ps->refs[ps->nb_refs].is_help = is_help;
+	ps->refs[ps->nb_refs].offset = offset;
+	ps->nb_refs++;
+}
+
+
+static PathResolver* new_path_resolver()
+{
+	// resolve the paths relative to the current directory until make enters another one
+	PathResolver *pr = malloc(sizeof(PathResolver));
+	pr->dirs = new_string_pool();
+	pr->canonical_capacity = 64;
+	pr->canonical = malloc(pr->canonical_capacity*sizeof(int));
+	pr->stack_capacity = 16;
+	pr->stack = malloc(pr->stack_capacity*sizeof(int));
+	pr->nb_stack = 0;
+	pr->last_len = -1;
+
+	char *cwd = getcwd(NULL, 0); // already canonical
+	pr->cwd_id = pool_intern(pr->dirs, (cwd != NULL) ? cwd : ".", (cwd != NULL) ? strlen(cwd) : 1);
+	pr->canonical[pr->cwd_id] = pr->cwd_id;
+	free(cwd);
+	return pr;
+}
+
+
+static void free_path_resolver(PathResolver *pr)
+{
+	free_string_pool(pr->dirs);
+	free(pr->canonical);
+	free(pr->stack);
+	free(pr);
+}
+
+
+static int resolve_dir(PathResolver *pr, char *dir, int len)
+{
+	// id of the canonical form of an absolute directory, realpath only the first time it is seen
+	int id = pool_intern(pr->dirs, dir, len);
+	if (pr->dirs->size > pr->canonical_capacity)
+	{
+		while (pr->dirs->size > pr->canonical_capacity)
+			pr->canonical_capacity *= 2;
+		pr->canonical = realloc(pr->canonical, pr->canonical_capacity*sizeof(int));
+	}
+	if (id == pr->dirs->size-1 && id != pr->cwd_id)
+	{
+		pr->canonical[id] = id; // kept as written if it does not exist here (log of another host)
+		char *real = realpath(pool_get(pr->dirs, id), NULL);
+		if (real != NULL)
+		{
+			int real_id = pool_intern(pr->dirs, real, strlen(real));
+			if (real_id == pr->dirs->size-1)
+			{
+				if (pr->dirs->size > pr->canonical_capacity)
+				{
+					pr->canonical_capacity *= 2;
+					pr->canonical = realloc(pr->canonical, pr->canonical_capacity*sizeof(int));
+				}
+				pr->canonical[real_id] = real_id; // a canonical path resolves to itself
+			}
+			pr->canonical[id] = real_id;
+			free(real);
+		}
+	}
+	return pr->canonical[id];
+}
+
+
+static int join_dir(PathResolver *pr, char *path, int len, char *buffer, int size)
+{
+	// write the absolute form of a directory in buffer, returns its length or -1 if it does not fit
+	int current = (pr->nb_stack > 0) ? pr->stack[pr->nb_stack-1] : pr->cwd_id;
+	if (len > 0 && path[0] == '/')
+	{
+		if (len >= size)
+			return -1;
+		memcpy(buffer, path, len);
+		return len;
+	}
+	char *base = pool_get(pr->dirs, current);
+	int base_len = strlen(base);
+	if (base_len+1+len >= size)
+		return -1;
+	memcpy(buffer, base, base_len);
+	if (len == 0)
+		return base_len;
+	buffer[base_len] = '/';
+	memcpy(buffer+base_len+1, path, len);
+	return base_len+1+len;
+}
+
+
+static int resolve_path(ParseState *ps, char *path, int len)
+{
+	// intern the canonical absolute path of a file named in the output
+	PathResolver *pr = ps->paths;
+	int current = (pr->nb_stack > 0) ? pr->stack[pr->nb_stack-1] : pr->cwd_id;
+	if (len == pr->last_len && current == pr->last_dir && memcmp(path, pr->last_path, len) == 0)
+		return pr->last_id; // errors of the same file come together
+	char buffer[2*OUTPUT_LINE_MAX];
+	int name_start = len;
+	while (name_start > 0 && path[name_start-1] != '/')
+		name_start--;
+	int dir_len = (name_start > 1) ? name_start-1 : name_start; // without the last '/', except for "/"
+
+	int joined = join_dir(pr, path, dir_len, buffer, sizeof(buffer));
+	if (joined < 0)
+		return pool_intern(ps->el->pool, path, len); // too long, kept as written
+	char *dir = pool_get(pr->dirs, resolve_dir(pr, buffer, joined));
+	int real_len = strlen(dir);
+	if (real_len+1+len-name_start >= (int)sizeof(buffer))
+		return pool_intern(ps->el->pool, path, len);
+	memcpy(buffer, dir, real_len);
+	if (real_len == 0 || buffer[real_len-1] != '/')
+		buffer[real_len++] = '/';
+	memcpy(buffer+real_len, path+name_start, len-name_start);
+	int id = pool_intern(ps->el->pool, buffer, real_len+len-name_start);
+	if (len < OUTPUT_LINE_MAX)
+	{
+		memcpy(pr->last_path, path, len);
+		pr->last_len = len;
+		pr->last_dir = current;
+		pr->last_id = id;
+	}
+	return id;
+}
+
+
+static inline int parse_make_line(ParseState *ps, char *line)
+{
+	// make[1]: Entering directory '/path', and its Leaving line : returns TRUE if the line came from make
+	char *colon = strchr(line, ':');
+	if (colon == NULL || colon[1] != ' ' || (colon[2] != 'E' && colon[2] != 'L'))
+		return FALSE;
+	int isEntering = (strncmp(colon+2, "Entering directory ", 19) == 0);
+	if (!isEntering && strncmp(colon+2, "Leaving directory ", 18) != 0)
+		return FALSE;
+	char *name_end = colon;
+	if (name_end > line && name_end[-1] == ']')
+		name_end = memchr(line, '[', colon-line); // make[2]
+	if (name_end == NULL || name_end-line < 4 || strncmp(name_end-4, "make", 4) != 0)
+		return FALSE;
+
+	char *dir = colon+2+(isEntering ? 19 : 18);
+	if (*dir == '\'' || *dir == '`')
+		dir++;
+	int len = strlen(dir);
+	while (len > 0 && (dir[len-1] == '\n' || dir[len-1] == '\''))
+		len--;
+
+	PathResolver *pr = ps->paths;
+	char buffer[2*OUTPUT_LINE_MAX];
+	int joined = join_dir(pr, dir, len, buffer, sizeof(buffer));
+	if (joined < 0)
+		return TRUE;
+	int id = resolve_dir(pr, buffer, joined);
+	if (isEntering)
+	{
+		if (pr->nb_stack == pr->stack_capacity)
+		{
+			pr->stack_capacity *= 2;
+			pr->stack = realloc(pr->stack, pr->stack_capacity*sizeof(int));
+		}
+		pr->stack[pr->nb_stack++] = id;
+	}
+	else
+	{
+		// the innermost entry of this directory, not always the last one with make -j
+		for (int i=pr->nb_stack-1; i>=0; i--)
+		{
+			if (pr->stack[i] == id)
+			{
+				memmove(pr->stack+i, pr->stack+i+1, (pr->nb_stack-i-1)*sizeof(int));
+				pr->nb_stack--;
+				break;
+			}
+		}
+	}
+	return TRUE;
+}
+
+
+static void parse_error(ParseState *ps, char *path, int path_len, int line_nb, int column, char *msg, int severity)
+{
+	// an error message with its location : new row, message of the previous row if on the same line, or duplicate
+	BlessErrorList *el = ps->el;
+	if (ps->is_full && (ps->isFirstUnit || severity > BLESS_SEVERITY_NOTE)) // the notes of the last error are kept
+	{
+		int tu_id = is_source_path(path, path_len) ? resolve_path(ps, path, path_len) : ps->tu_id;
+		if (!ps->isFirstUnit || tu_id != ps->failed_tu)
+		{
+			ps->is_stopped = TRUE; // error of the next translation unit, or past the cap
+			return;
+		}
+	}
+	ps->is_new_code = TRUE;
+	ps->is_ignored = FALSE;
+	ps->file_id = resolve_path(ps, path, path_len);
+	if (column > 65535)
+		column = 65535; // clamp to the column width
+	if (is_source_path(path, path_len)) // a source file is its own translation unit
+		ps->tu_id = ps->file_id;
+
+	DiagEntry *known = diag_find(ps->seen, el->text, ps->file_id, line_nb, column, msg);
+	if (known != NULL)
+	{
+		// same error already reported by another translation unit, only count it
+		if (known->is_first)
+		{
+			int i = sparse_add(&el->occurrences, known->row, 1); // may move values
+			el->occurrences.values[i] += 1;
+		}
+		ps->row = known->row;
+		ps->is_ignored = TRUE;
+	}
+	else
+	{
+		int is_first = TRUE;
+		if (ps->row >= 0 && el->file_id[ps->row] == ps->file_id && el->line_nb[ps->row] == line_nb)
+		{
+			// the error is on the same line as the previous error
+			is_first = FALSE;
+		}
+		else
+		{
+			ps->row = add_row(el); // create the next row
+			el->file_id[ps->row] = ps->file_id; // set the filename
+			el->function_id[ps->row] = ps->function_id; // set the function_name
+			el->line_nb[ps->row] = line_nb; // set the error line number
+			el->column[ps->row] = column; // set the error column
+
+			if (severity >= BLESS_SEVERITY_ERROR)
+			{
+				ps->nb_errors++;
+				if (ps->failed_tu < 0)
+					ps->failed_tu = ps->tu_id;
+				if ((ps->max_errors > 0 && ps->nb_errors >= ps->max_errors) || ps->isFirstUnit)
+					ps->is_full = TRUE; // its code and help lines are still read
+			}
+		}
+
+		unsigned int offset = add_text(el, msg, strlen(msg));
+		if (severity > el->severity[ps->row])
+			el->severity[ps->row] = severity;
+		add_ref(ps, FALSE, offset);
+		diag_insert(ps->seen, el->text, ps->file_id, line_nb, column, ps->row, offset, is_first);
+	}
+
+	// record the translation unit reporting the error
+	if (ps->nb_tu_pairs == ps->tu_pairs_capacity)
+	{
+		ps->tu_pairs_capacity *= 2;
+		ps->tu_pairs = realloc(ps->tu_pairs, 2*ps->tu_pairs_capacity*sizeof(int));
+	}
+	ps->tu_pairs[2*ps->nb_tu_pairs] = ps->row;
+	ps->tu_pairs[2*ps->nb_tu_pairs+1] = ps->tu_id;
+	ps->nb_tu_pairs++;
+}
+
+
+static void parse_code(ParseState *ps, char *code, int isRowLine)
+{
+	// source excerpt : the line of the error is its code line, the lines around it are help lines
+	BlessErrorList *el = ps->el;
+	if (isRowLine && ps->is_new_code)
+	{
+		if (el->origin_code[ps->row] == 0) // another error of the same line already set it
+		{
+			el->origin_code[ps->row] = add_text(el, code, strlen(code)); // copy the code line
+			el->line_hash[ps->row] = code_hash(code, strlen(code)); // to detect a later change on disk
+		}
+		ps->is_new_code = FALSE;
+	}
+	else
+	{
+		add_ref(ps, TRUE, add_text(el, code, strlen(code))); // code line following the error line
+	}
+}
+
+
+static void parse_fixit(ParseState *ps, char *line)
+{
+	// fix-it hint of the current row, fix-it:"file":{line:col-line:col}:"text"
+	BlessErrorList *el = ps->el;
+	char *name_end = strchr(line+8, '"');
+	if (name_end == NULL || strncmp(name_end, "\":{", 3) != 0)
+		return;
+	if (el->nb_fixits == el->fixits_capacity)
+	{
+		el->fixits_capacity = (el->fixits_capacity == 0) ? 16 : el->fixits_capacity*2;
+		el->fixits = realloc(el->fixits, el->fixits_capacity*sizeof(FixIt));
+	}
+	FixIt *fixit = &el->fixits[el->nb_fixits];
+	char *end = NULL;
+	fixit->row = ps->row;
+	fixit->file_id = resolve_path(ps, line+8, name_end-line-8);
+	fixit->line_start = strtol(name_end+3, &end, 10);
+	fixit->col_start = strtol(end+1, &end, 10);
+	fixit->line_end = strtol(end+1, &end, 10);
+	fixit->col_end = strtol(end+1, &end, 10);
+	fixit->is_applied = FALSE;
+	if (strncmp(end, "}:\"", 3) != 0)
+		return; // not a fix-it after all
+	el->nb_fixits++;
+
+	// the replacement is escaped like a C string
+	char *replacement = malloc(strlen(line)+1);
+	int len = unescape_fixit(end+3, replacement);
+	fixit->text = add_text(el, replacement, len);
+	free(replacement);
+}
+
+
+static int ld_severity(char *msg)
+{
+	// linker messages have no "error:" prefix, anything but a warning stops the link
+	return (strncmp(msg, "warning:", 8) == 0) ? BLESS_SEVERITY_WARNING : BLESS_SEVERITY_ERROR;
+}
+
+
+static inline int parse_ld_line(ParseState *ps, char *line)
+{
+	// GNU ld output, returns TRUE if the line came from the linker
+	//   /usr/bin/ld: main.o: in function `main':
+	//   main.c:12:(.text+0x9): undefined reference to `f'   (main.c:(.text+0x9) without debug info)
+	//   /usr/bin/ld: cannot find -lm
+	char *colon = strchr(line, ':');
+	if (colon == NULL)
+		return FALSE;
+	if (colon-line == 8 && strncmp(line, "collect2", 8) == 0)
+		return TRUE; // exit status of the link, already known from the errors
+
+	if (colon[1] == ' ' && is_linker_path(line, colon-line))
+	{
+		char *text = colon+2;
+		ps->is_linking = TRUE;
+		char *in_function = strstr(text, ": in function ");
+		if (in_function != NULL)
+		{
+			ps->function_id = pool_intern(ps->el->pool, in_function+1, strlen(in_function)-3); // without ":\n"
+			return TRUE;
+		}
+		if (!parse_ld_line(ps, text)) // object with a section, or no location at all
+		{
+			parse_error(ps, line, colon-line, 0, 0, text, ld_severity(text));
+			ps->is_ignored = TRUE; // the linker prints no source excerpt
+		}
+		return TRUE;
+	}
+
+	// file:line:(section+offset): message, file:(section+offset): message, file:line: message
+	char *pos = colon+1;
+	char *msg = NULL;
+	int line_nb = 0;
+	if (isdigit((unsigned char)*pos))
+	{
+		line_nb = strtol(pos, &pos, 10);
+		if (*pos != ':')
+			return FALSE;
+		pos++;
+	}
+	if (*pos == '(' && (msg = strstr(pos, "): ")) != NULL)
+		msg += 3;
+	else if (*pos == ' ' && line_nb > 0 && ps->is_linking) // without column, only the linker
+		msg = pos+1;
+	else
+		return FALSE;
+	parse_error(ps, line, colon-line, line_nb, 0, msg, ld_severity(msg));
+	ps->is_ignored = TRUE; // the linker prints no source excerpt
+	return TRUE;
+}
+
+
+static inline void parse_cc_line(ParseState *ps, char *line, const int toolchain)
+{
+	// gcc, g++ and clang output, with the errors of the linker they drive
+	int path_len;
+	int line_nb;
+	int column;
+	int code_line;
+	char *text;
+
+	if (line[0] == ' ' && ps->is_including)
+	{
+		//                  from main.c:4:
+		char *from = line+strspn(line, " ");
+		char *from_end = strchr(from, ':');
+		if (strncmp(from, "from ", 5) == 0 && from_end != NULL)
+		{
+			ps->tu_id = resolve_path(ps, from+5, from_end-from-5); // the last file of the chain is the translation unit
+			return;
+		}
+	}
+	ps->is_including = FALSE;
+
+	if (line[0] != ' ')
+	{
+		if (ps->is_linking && parse_ld_line(ps, line))
+			return;
+		if (strncmp(line, "In file included from ", 22) == 0)
+		{
+			ps->is_linking = FALSE;
+			ps->is_including = TRUE;
+			char *tu_end = strchr(line+22, ':');
+			if (tu_end != NULL)
+				ps->tu_id = resolve_path(ps, line+22, tu_end-line-22);
+			return;
+		}
+		if ((text = match_location(line, &path_len, &line_nb, &column)) != NULL && text[0] != '(')
+		{
+			ps->is_linking = FALSE;
+			parse_error(ps, line, path_len, line_nb, column, text, message_severity(text));
+			return;
+		}
+		if (parse_ld_line(ps, line))
+			return;
+		if ((text = strstr(line, ": ")) != NULL && text > line && text[-1] != ':' && memchr(line, ' ', text-line) == NULL
+			&& memchr(line, '.', text-line) != NULL && strlen(text) > 3 && text[strlen(text)-2] == ':')
+		{
+			// file.c: In function 'f':
+			ps->is_linking = FALSE;
+			if (is_source_path(line, text-line)) // a source file is its own translation unit
+				ps->tu_id = resolve_path(ps, line, text-line);
+			ps->function_id = pool_intern(ps->el->pool, text+1, strlen(text)-3); // without ":\n"
+			return;
+		}
+	}
+
+	if (ps->row < 0 || ps->is_ignored)
+		return; // no new error to attach the code and help lines to
+
+	if (strncmp(line, "fix-it:\"", 8) == 0)
+	{
+		parse_fixit(ps, line);
+		return;
+	}
+
+	if ((text = match_gutter(line, &code_line)) != NULL)
+	{
+		if (code_line >= 0)
+			parse_code(ps, text, code_line == ps->el->line_nb[ps->row]);
+		else
+			add_ref(ps, TRUE, add_text(ps->el, text, strlen(text))); // copy the help line
+		return;
+	}
+
+	if (toolchain == TOOLCHAIN_CLANG)
+	{
+		// clang before version 19 prints the code line without a gutter, then the caret line
+		char *pos = line;
+		while (*pos == ' ')
+			pos++;
+		char *driver = strstr(line, ": error: ");
+		if (driver == NULL)
+			driver = strstr(line, ": warning: ");
+		if (*pos == '\n' || *pos == '\0' || strstr(line, " generated.\n") != NULL
+			|| (driver != NULL && memchr(line, ' ', driver-line) == NULL))
+			return; // blank line, "1 error generated." or "clang: error: linker command failed"
+		parse_code(ps, line, TRUE); // only the line of the error is printed
+	}
+}
+
+
+static inline void parse_rustc_line(ParseState *ps, char *line)
+{
+	// rustc and cargo output : the message comes first, its location on the next line
+	//   error[E0425]: cannot find value `x` in this scope
+	//    --> src/main.rs:3:13
+	int path_len;
+	int line_nb;
+	int column;
+	int code_line;
+	char *text;
+
+	if ((strncmp(line, "error", 5) == 0 && (line[5] == ':' || line[5] == '['))
+		|| (strncmp(line, "warning", 7) == 0 && (line[7] == ':' || line[7] == '[')))
+	{
+		memcpy(ps->pending, line, strlen(line)+1); // shorter than OUTPUT_LINE_MAX, read by fgets
+		ps->has_pending = TRUE;
+		ps->is_ignored = TRUE; // until its location is known, "error: aborting..." has none
+		return;
+	}
+
+	char *pos = line;
+	while (*pos == ' ')
+		pos++;
+	if (strncmp(pos, "--> ", 4) == 0 && ps->has_pending
+		&& match_location(pos+4, &path_len, &line_nb, &column) != NULL)
+	{
+		parse_error(ps, pos+4, path_len, line_nb, column, ps->pending, message_severity(ps->pending));
+		ps->has_pending = FALSE;
+		return;
+	}
+
+	if (ps->row < 0 || ps->is_ignored)
+		return; // no new error to attach the code and help lines to
+
+	if ((text = match_gutter(line, &code_line)) != NULL)
+	{
+		if (code_line >= 0)
+			parse_code(ps, text, code_line == ps->el->line_nb[ps->row]);
+		else if (*text != '\n' && *text != '\0')
+			add_ref(ps, TRUE, add_text(ps->el, text, strlen(text))); // caret and label
+		return;
+	}
+
+	if (*pos == '=' || strncmp(pos, "::: ", 4) == 0 || strncmp(line, "help:", 5) == 0 || strncmp(line, "note:", 5) == 0)
+		add_ref(ps, TRUE, add_text(ps->el, pos, strlen(pos))); // "= note: ...", other location, sub-diagnostic
+}
+
+
+static inline int continues_error(ParseState *ps, char *line, const int toolchain)
+{
+	// whether a line at column 0 still belongs to the last error once the capture is full
+	int path_len;
+	int line_nb;
+	int column;
+	char *text;
+	if (strncmp(line, "fix-it:", 7) == 0)
+		return TRUE;
+	if (toolchain == TOOLCHAIN_CLANG && (ps->is_new_code || line[0] == '^' || line[0] == '~'))
+		return TRUE; // code line without gutter, and its caret
+	if (toolchain == TOOLCHAIN_RUSTC && (strncmp(line, "help:", 5) == 0 || strncmp(line, "note:", 5) == 0))
+		return TRUE;
+	if (!ps->isFirstUnit)
+	{
+		// a note of the last error, often with its fix-it, the next error or warning ends the capture
+		return toolchain != TOOLCHAIN_RUSTC && (text = match_location(line, &path_len, &line_nb, &column)) != NULL
+			&& strncmp(text, "note:", 5) == 0;
+	}
+	// the other errors of the failed translation unit, parse_error stops at the next unit
+	if (toolchain == TOOLCHAIN_RUSTC)
+		return strncmp(line, "error", 5) == 0 || strncmp(line, "warning", 7) == 0 || line[0] == '\n';
+	return strncmp(line, "In file included from ", 22) == 0 || strstr(line, ": In ") != NULL
+		|| match_location(line, &path_len, &line_nb, &column) != NULL;
+}
+
+
+static inline void parse_lines(ParseState *ps, FILE *p, char **lines, int nb_lines, const int toolchain)
+{
+	// parse loop, inlined in one function per toolchain so the switch is resolved at compile time
+	char buffer[OUTPUT_LINE_MAX]; // buffer for reading the output
+	int i = 0;
+	while (TRUE)
+	{
+		char *line = (i < nb_lines) ? lines[i++] : fgets(buffer, OUTPUT_LINE_MAX, p); // sniffed lines first
+		if (line == NULL) break;
+		if (ps->is_full && line[0] != ' ' && !continues_error(ps, line, toolchain))
+			ps->is_stopped = TRUE; // e.g. "make: *** [x.o] Error 1", or the next command echoed by make
+		if (ps->is_stopped) break;
+		if (line[0] != ' ' && parse_make_line(ps, line))
+			continue; // directory of the next relative paths
+
+		switch (toolchain)
+		{
+			case TOOLCHAIN_RUSTC:
+				parse_rustc_line(ps, line);
+				break;
+			case TOOLCHAIN_LD:
+				parse_ld_line(ps, line);
+				break;
+			default:
+				parse_cc_line(ps, line, toolchain);
+		};
+		if (ps->is_stopped) break;
+	}
+}
+
+
+static void parse_gcc(ParseState *ps, FILE *p, char **lines, int nb_lines) { parse_lines(ps, p, lines, nb_lines, TOOLCHAIN_GCC); }
+static void parse_clang(ParseState *ps, FILE *p, char **lines, int nb_lines) { parse_lines(ps, p, lines, nb_lines, TOOLCHAIN_CLANG); }
+static void parse_rustc(ParseState *ps, FILE *p, char **lines, int nb_lines) { parse_lines(ps, p, lines, nb_lines, TOOLCHAIN_RUSTC); }
+static void parse_ld(ParseState *ps, FILE *p, char **lines, int nb_lines) { parse_lines(ps, p, lines, nb_lines, TOOLCHAIN_LD); }
+
+
+static int sniff_rustc(char **lines, int nb_lines)
+{
+	// a message followed by its " --> " location line
+	for (int i=1; i<nb_lines; i++)
+	{
+		char *pos = lines[i];
+		while (*pos == ' ')
+			pos++;
+		if (strncmp(pos, "--> ", 4) == 0 && (strncmp(lines[i-1], "error", 5) == 0 || strncmp(lines[i-1], "warning", 7) == 0))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static int is_caret_line(char *line)
+{
+	// "      ^~~~", as printed under a code line without gutter
+	int pos = strspn(line, " ~");
+	return line[pos] == '^' && line[pos+1+strspn(line+pos+1, " ~^")] == '\n';
+}
+
+
+static int sniff_clang(char **lines, int nb_lines)
+{
+	// "N errors generated.", or an error followed by its code line without gutter and a caret line
+	// a numbered gutter means gcc (clang 19 prints one too, but also the "generated" line)
+	int path_len;
+	int line_nb;
+	int column;
+	int code_line;
+	for (int i=0; i<nb_lines; i++)
+	{
+		if (strstr(lines[i], " generated.\n") != NULL && (strstr(lines[i], " error") != NULL || strstr(lines[i], " warning") != NULL))
+			return TRUE;
+	}
+	for (int i=0; i<nb_lines; i++)
+	{
+		if (match_gutter(lines[i], &code_line) != NULL && code_line >= 0)
+			return FALSE;
+	}
+	for (int i=0; i+2 < nb_lines; i++)
+	{
+		if (lines[i][0] != ' ' && match_location(lines[i], &path_len, &line_nb, &column) != NULL
+			&& match_location(lines[i+1], &path_len, &line_nb, &column) == NULL
+			&& lines[i+1][strspn(lines[i+1], " \n")] != '\0' && is_caret_line(lines[i+2]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static int sniff_gcc(char **lines, int nb_lines)
+{
+	// an error with its location, as printed by gcc and g++
+	int path_len;
+	int line_nb;
+	int column;
+	for (int i=0; i<nb_lines; i++)
+	{
+		if (lines[i][0] != ' ' && match_location(lines[i], &path_len, &line_nb, &column) != NULL)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static int sniff_ld(char **lines, int nb_lines)
+{
+	// a line starting with the linker name
+	for (int i=0; i<nb_lines; i++)
+	{
+		char *colon = strchr(lines[i], ':');
+		if (colon != NULL && is_linker_path(lines[i], colon-lines[i]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+// parser backends, in sniffing order, indexed by TOOLCHAIN_*
+static Toolchain toolchains[] = {
+	{"rustc", sniff_rustc, parse_rustc},
+	{"clang", sniff_clang, parse_clang},
+	{"gcc", sniff_gcc, parse_gcc},
+	{"ld", sniff_ld, parse_ld},
+};
+
+
+static int is_diagnostic_line(char *line)
+{
+	// whether a line may start a diagnostic of one of the backends, the build preamble is not sniffed
+	int path_len;
+	int line_nb;
+	int column;
+	char *colon = strchr(line, ':');
+	if (line[0] == ' ')
+		return FALSE;
+	return strncmp(line, "error", 5) == 0 || strncmp(line, "warning", 7) == 0
+		|| match_location(line, &path_len, &line_nb, &column) != NULL
+		|| (colon != NULL && is_linker_path(line, colon-line));
+}
+
+
+static int sniff_toolchain(char **lines, int nb_lines)
+{
+	// first parser backend recognizing the output, -1 if none
+	for (int i=0; i<(int)(sizeof(toolchains)/sizeof(Toolchain)); i++)
+	{
+		if (toolchains[i].sniff(lines, nb_lines))
+			return i;
+	}
+	return -1;
+}
+
+
+BlessErrorList* bless_parse_until(FILE *p, int max_errors, int isFirstUnit, int *isStopped)
+{
+	// parse the output of a build and stores the errors in a BlessErrorList
+	// the first lines from the first diagnostic choose the parser backend, which then reads everything,
+	// or until max_errors errors (0 for no cap) or the end of the first translation unit with errors are captured
+	// the preamble before the first diagnostic (make, cargo, stdout of the build) is buffered whatever its length
+	char line[OUTPUT_LINE_MAX]; // buffer for reading the output
+	int lines_capacity = SNIFF_LINES;
+	char **lines = malloc(lines_capacity*sizeof(char*));
+	int nb_lines = 0;
+	int first = -1; // first line looking like a diagnostic
+	int toolchain = -1;
+	int path_len;
+	int line_nb;
+	int column;
+	while ((first < 0 || nb_lines-first < SNIFF_LINES) && fgets(line, OUTPUT_LINE_MAX, p) != NULL)
+	{
+		if (nb_lines == lines_capacity)
+		{
+			lines_capacity *= 2;
+			lines = realloc(lines, lines_capacity*sizeof(char*));
+		}
+		lines[nb_lines++] = strdup(line);
+		if (first < 0 && is_diagnostic_line(line))
+			first = nb_lines-1;
+		if (first >= 0 && (max_errors > 0 || isFirstUnit))
+		{
+			// the first error may be all the build prints for a while : choose as soon as the
+			// line after it is read, which tells clang from gcc
+			toolchain = sniff_toolchain(lines+first, nb_lines-first);
+			if (toolchain >= 0 && (toolchain != TOOLCHAIN_GCC || match_location(line, &path_len, &line_nb, &column) == NULL))
+				break;
+		}
+	}
+
+	toolchain = (first >= 0) ? sniff_toolchain(lines+first, nb_lines-first) : -1;
+	if (toolchain < 0)
+		toolchain = TOOLCHAIN_GCC; // when nothing is recognized
+
+	ParseState ps;
+	memset(&ps, 0, sizeof(ParseState));
+	ps.el = new_error_list(); // creating the error list
+	ps.file_id = -1;
+	ps.function_id = -1;
+	ps.tu_id = -1;
+	ps.row = -1;
+	ps.is_new_code = TRUE;
+	ps.seen = new_diag_table(); // errors already parsed, for deduplication
+	ps.refs_capacity = 256;
+	ps.refs = malloc(ps.refs_capacity*sizeof(TextRef));
+	ps.tu_pairs_capacity = 256;
+	ps.tu_pairs = malloc(2*ps.tu_pairs_capacity*sizeof(int));
+	ps.paths = new_path_resolver();
+	ps.max_errors = max_errors;
+	ps.isFirstUnit = isFirstUnit;
+	ps.failed_tu = -1;
+
+	toolchains[toolchain].parse(&ps, p, lines, nb_lines); // one call per output, not per line
+
+	for (int i=0; i<nb_lines; i++)
+		free(lines[i]);
+	free(lines);
+	free_diag_table(ps.seen);
+	free_path_resolver(ps.paths);
+	if (isStopped != NULL)
+		*isStopped = ps.is_stopped;
+
+	BlessErrorList *error_list = ps.el;
+	group_by_row(error_list, ps.refs, ps.nb_refs, ps.tu_pairs, ps.nb_tu_pairs);
+	free(ps.refs);
+	free(ps.tu_pairs);
+
+	rank_errors(error_list);
+	stamp_files(error_list);
+
+	return error_list;
+}
+
+
+BlessErrorList* bless_parse_output(FILE *p)
+{
+	return bless_parse_until(p, 0, FALSE, NULL);
+}
+
+
+BlessErrorList* bless_run_until(char *user_cmd, int max_errors, int isFirstUnit, int *isStopped)
+{
+	// run the given command and parse its output until it ends or enough errors are captured
+	// a stopped command is terminated with its whole process group, returns NULL if it cannot run
+	int isLimited = (max_errors > 0 || isFirstUnit);
+	int fds[2];
+	if (pipe(fds) != 0)
+		return NULL;
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return NULL;
+	}
+	if (pid == 0)
+	{
+		if (isLimited)
+			setpgid(0, 0); // its own group, make and its compilers are terminated together
+		dup2(fds[1], STDOUT_FILENO); // the directories make enters are printed on stdout
+		dup2(fds[1], STDERR_FILENO); // the errors
+		close(fds[0]);
+		close(fds[1]);
+		execl("/bin/sh", "sh", "-c", user_cmd, (char*)NULL);
+		_exit(127);
+	}
+	if (isLimited)
+		setpgid(pid, pid); // also from here, the group exists before it can be signaled
+	close(fds[1]);
+
+	int isCut = FALSE;
+	FILE *p = fdopen(fds[0], "r");
+	BlessErrorList *error_list = bless_parse_until(p, max_errors, isFirstUnit, &isCut);
+	if (isCut)
+		kill(-pid, SIGTERM); // the rest of the build is not needed
+	fclose(p);
+	waitpid(pid, NULL, 0);
+
+	if (isStopped != NULL)
+		*isStopped = isCut;
+	return error_list;
+}
+
+
+BlessErrorList* bless_run_command(char* user_cmd)
+{
+	// run the given command and stores the output errrors in a BlessErrorList
+	return bless_run_until(user_cmd, 0, FALSE, NULL);
+}
+
+
+static int log_write(LogReader *log, const char *data, long len)
+{
+	// copy decompressed bytes in the ring, waiting for the parser when it is full
+	// returns FALSE once the parser has stopped reading
+	pthread_mutex_lock(&log->lock);
+	while (len > 0 && !log->is_closed)
+	{
+		unsigned long long free_bytes = LOG_RING_SIZE - (log->head - log->tail);
+		if (free_bytes == 0)
+		{
+			pthread_cond_wait(&log->can_write, &log->lock);
+			continue;
+		}
+		long pos = log->head % LOG_RING_SIZE;
+		long n = LOG_RING_SIZE - pos; // contiguous bytes before the end of the ring
+		if (n > len) n = len;
+		if ((unsigned long long)n > free_bytes) n = free_bytes;
+		pthread_mutex_unlock(&log->lock);
+		memcpy(log->ring+pos, data, n); // this part of the ring is not read before head moves
+		pthread_mutex_lock(&log->lock);
+		log->head += n;
+		data += n;
+		len -= n;
+		pthread_cond_signal(&log->can_read);
+	}
+	int isOpen = !log->is_closed;
+	pthread_mutex_unlock(&log->lock);
+	return isOpen;
+}
+
+
+static void* log_loop(void *arg)
+{
+	// decompression thread : read the log by chunks and write the decompressed bytes in the ring
+	LogReader *log = arg;
+	char *in = malloc(LOG_CHUNK);
+	char *out = malloc(LOG_CHUNK);
+	long n;
+	int isOpen = TRUE;
+
+	if (log->format == LOG_GZIP)
+	{
+		z_stream z;
+		memset(&z, 0, sizeof(z_stream));
+		inflateInit2(&z, 15+32); // gzip or zlib header, detected
+		int status = Z_OK;
+		while (isOpen && status != Z_DATA_ERROR && (n = read(log->fd, in, LOG_CHUNK)) > 0)
+		{
+			z.next_in = (unsigned char*)in;
+			z.avail_in = n;
+			while (isOpen && z.avail_in > 0)
+			{
+				z.next_out = (unsigned char*)out;
+				z.avail_out = LOG_CHUNK;
+				status = inflate(&z, Z_NO_FLUSH);
+				if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+					break; // corrupted log, keep what has been parsed
+				isOpen = log_write(log, out, LOG_CHUNK-z.avail_out);
+				if (status == Z_STREAM_END)
+					inflateReset(&z); // concatenated gzip members, as written by appending logs
+			}
+		}
+		inflateEnd(&z);
+	}
+#ifdef BLESS_ZSTD
+	else if (log->format == LOG_ZSTD)
+	{
+		ZSTD_DStream *z = ZSTD_createDStream();
+		ZSTD_initDStream(z);
+		int isError = FALSE;
+		while (isOpen && !isError && (n = read(log->fd, in, LOG_CHUNK)) > 0)
+		{
+			ZSTD_inBuffer zin = {in, n, 0};
+			while (isOpen && zin.pos < zin.size)
+			{
+				ZSTD_outBuffer zout = {out, LOG_CHUNK, 0};
+				isError = ZSTD_isError(ZSTD_decompressStream(z, &zout, &zin));
+				if (isError)
+					break; // corrupted log, keep what has been parsed
+				isOpen = log_write(log, out, zout.pos);
+			}
+		}
+		ZSTD_freeDStream(z);
+	}
+#endif
+	else
+	{
+		while (isOpen && (n = read(log->fd, in, LOG_CHUNK)) > 0)
+			isOpen = log_write(log, in, n);
+	}
+
+	free(in);
+	free(out);
+	pthread_mutex_lock(&log->lock);
+	log->is_over = TRUE;
+	pthread_cond_signal(&log->can_read);
+	pthread_mutex_unlock(&log->lock);
+	return NULL;
+}
+
+
+static ssize_t log_read(void *cookie, char *buf, size_t size)
+{
+	// stream read function : take the decompressed bytes from the ring, 0 at the end of the log
+	LogReader *log = cookie;
+	pthread_mutex_lock(&log->lock);
+	while (log->head == log->tail && !log->is_over)
+		pthread_cond_wait(&log->can_read, &log->lock);
+	unsigned long long available = log->head - log->tail;
+	pthread_mutex_unlock(&log->lock);
+
+	long pos = log->tail % LOG_RING_SIZE;
+	long n = LOG_RING_SIZE - pos; // contiguous bytes before the end of the ring
+	if ((unsigned long long)n > available) n = available;
+	if ((size_t)n > size) n = size;
+	memcpy(buf, log->ring+pos, n); // this part of the ring is not written before tail moves
+
+	pthread_mutex_lock(&log->lock);
+	log->tail += n;
+	pthread_cond_signal(&log->can_write);
+	pthread_mutex_unlock(&log->lock);
+	return n;
+}
+
+
+static int log_close(void *cookie)
+{
+	// stream close function : stop the decompression thread, even in the middle of the log
+	LogReader *log = cookie;
+	pthread_mutex_lock(&log->lock);
+	log->is_closed = TRUE;
+	pthread_cond_signal(&log->can_write);
+	pthread_mutex_unlock(&log->lock);
+	pthread_join(log->thread, NULL);
+
+	close(log->fd);
+	pthread_mutex_destroy(&log->lock);
+	pthread_cond_destroy(&log->can_read);
+	pthread_cond_destroy(&log->can_write);
+	free(log->ring);
+	free(log);
+	return 0;
+}
+
+
+static FILE* open_log(char *path)
+{
+	// open a plain, gzip or zstd build log as a stream decompressed by another thread
+	// returns NULL if the log cannot be read
+	unsigned char magic[4] = {0};
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	long n = pread(fd, magic, 4, 0);
+
+	int format = LOG_PLAIN;
+	if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+		format = LOG_GZIP;
+	else if (n == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+		format = LOG_ZSTD;
+#ifndef BLESS_ZSTD
+	if (format == LOG_ZSTD)
+	{
+		close(fd);
+		return NULL; // built without zstd
+	}
+#endif
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	LogReader *log = calloc(1, sizeof(LogReader));
+	log->ring = malloc(LOG_RING_SIZE);
+	log->fd = fd;
+	log->format = format;
+	pthread_mutex_init(&log->lock, NULL);
+	pthread_cond_init(&log->can_read, NULL);
+	pthread_cond_init(&log->can_write, NULL);
+
+	if (pthread_create(&log->thread, NULL, log_loop, log) != 0)
+	{
+		close(fd);
+		pthread_mutex_destroy(&log->lock);
+		pthread_cond_destroy(&log->can_read);
+		pthread_cond_destroy(&log->can_write);
+		free(log->ring);
+		free(log);
+		return NULL;
+	}
+
+	cookie_io_functions_t functions = {log_read, NULL, NULL, log_close};
+	FILE *f = fopencookie(log, "r", functions);
+	if (f == NULL)
+		log_close(log); // stops the thread and frees the reader
+	return f;
+}
+
+
+BlessErrorList* bless_read_log(char *path)
+{
+	// parse a build log instead of running a command, NULL if it cannot be read
+	FILE *f = open_log(path);
+	if (f == NULL)
+		return NULL;
+	BlessErrorList *error_list = bless_parse_output(f);
+	fclose(f);
+	return error_list;
+}
+
+
+static int compare_patch(const void *a, const void *b)
+{
+	// order patches by file, then position, user edits before fix-its at the same position
+	Patch *pa = (Patch*)a;
+	Patch *pb = (Patch*)b;
+	if (pa->file_id != pb->file_id)
+		return pa->file_id - pb->file_id;
+	if (pa->line_start != pb->line_start)
+		return pa->line_start - pb->line_start;
+	if (pa->col_start != pb->col_start)
+		return pa->col_start - pb->col_start;
+	return (pa->fixit >= 0) - (pb->fixit >= 0);
+}
+
+
+static int line_shift(Patch *patches, int nb_patches, int file_id, int line)
+{
+	// number of lines added (or removed) before a line by the applied patches
+	int shift = 0;
+	for (int i=0; i<nb_patches; i++)
+	{
+		Patch *patch = &patches[i];
+		if (patch->file_id != file_id || !patch->is_applied) continue;
+		if (patch->line_end > line || (patch->line_end == line && patch->col_end > 1)) continue;
+
+		for (char *c=patch->text; *c != '\0'; c++)
+			shift += (*c == '\n');
+		shift -= patch->line_end - patch->line_start;
+	}
+	return shift;
+}
+
+
+static long* index_lines(char *content, long size, int *nb_lines)
+{
+	// offsets of the start of every line, followed by the size of the content
+	int capacity = 256;
+	long *starts = malloc(capacity*sizeof(long));
+	int nb = 0;
+	long offset = 0;
+	while (offset < size)
+	{
+		if (nb+1 == capacity)
+		{
+			capacity *= 2;
+			starts = realloc(starts, capacity*sizeof(long));
+		}
+		starts[nb++] = offset;
+		char *eol = memchr(content+offset, '\n', size-offset);
+		offset = (eol == NULL) ? size : eol-content+1;
+	}
+	starts[nb] = size;
+	*nb_lines = nb;
+	return starts;
+}
+
+
+static int patch_row(BlessErrorList *el, Patch *patch)
+{
+	// row whose code line the patch is checked against
+	return (patch->fixit >= 0) ? el->fixits[patch->fixit].row : patch->row;
+}
+
+
+static void rebase_patches(BlessErrorList *el, char *content, long size, Patch *patches, int nb_patches)
+{
+	// the file changed since the parse : check the line of every patch against its hash
+	// a line found elsewhere moves its row and patches, a line not found marks its patches stale
+	int nb_lines = 0;
+	long *starts = index_lines(content, size, &nb_lines);
+	unsigned int *hashes = malloc((nb_lines+1)*sizeof(unsigned int));
+	for (int i=0; i<nb_lines; i++)
+		hashes[i] = code_hash(content+starts[i], starts[i+1]-starts[i]);
+
+	int *deltas = malloc(nb_patches*sizeof(int));
+	for (int i=0; i<nb_patches; i++)
+	{
+		int row = patch_row(el, &patches[i]);
+		int line = el->line_nb[row]-1;
+		// only the line of the row has a hash, 0 when its excerpt was not printed
+		unsigned int expected = (patches[i].line_start == line+1) ? el->line_hash[row] : 0;
+		int found = FALSE;
+		deltas[i] = 0;
+
+		// nearest line with the same content, the original position first
+		for (int d=0; expected != 0 && !found && (line-d >= 0 || line+d < nb_lines); d++)
+		{
+			if (line+d >= 0 && line+d < nb_lines && hashes[line+d] == expected)
+			{
+				deltas[i] = d;
+				found = TRUE;
+			}
+			else if (line-d >= 0 && line-d < nb_lines && hashes[line-d] == expected)
+			{
+				deltas[i] = -d;
+				found = TRUE;
+			}
+		}
+		patches[i].is_stale = !found;
+	}
+
+	// the patches of a row share its delta : move the patches, then each row and its fix-its once
+	int *row_deltas = calloc(el->size+1, sizeof(int));
+	for (int i=0; i<nb_patches; i++)
+	{
+		if (patches[i].is_stale || deltas[i] == 0) continue;
+		patches[i].line_start += deltas[i];
+		patches[i].line_end += deltas[i];
+		row_deltas[patch_row(el, &patches[i])] = deltas[i];
+	}
+	for (int row=0; row<el->size; row++)
+		el->line_nb[row] += row_deltas[row];
+	for (int i=0; i<el->nb_fixits; i++)
+	{
+		if (el->fixits[i].is_applied) continue;
+		el->fixits[i].line_start += row_deltas[el->fixits[i].row];
+		el->fixits[i].line_end += row_deltas[el->fixits[i].row];
+	}
+	qsort(patches, nb_patches, sizeof(Patch), compare_patch); // the moved patches may be out of order
+
+	free(row_deltas);
+	free(deltas);
+	free(hashes);
+	free(starts);
+}
+
+
+static int patch_file(BlessErrorList *el, int file_id, Patch *patches, int nb_patches)
+{
+	// apply the sorted patches of one file in a single read and a single write
+	// the file is checked against its stamp first, and only if it changed against the line hashes
+	// overlapping patches are skipped, returns TRUE if an error has happened
+	char *filename = pool_get(el->pool, file_id);
+	struct stat st;
+	FILE *forigin = fopen(filename, "r"); // origin file
+	if (forigin == NULL || fstat(fileno(forigin), &st) != 0)
+	{
+		if (forigin != NULL) fclose(forigin);
+		return TRUE;
+	}
+	char *content = malloc(st.st_size+1);
+	long size = fread(content, 1, st.st_size, forigin);
+	fclose(forigin);
+
+	FileStamp *stamp = (file_id < el->nb_stamps) ? &el->stamps[file_id] : NULL;
+	int isUnchanged = (stamp != NULL && stamp->size == size && stamp->mtime == stat_mtime(&st));
+	if (!isUnchanged)
+		rebase_patches(el, content, size, patches, nb_patches); // slow path
+
+	// the new content is built in memory, then written at once
+	long out_size = 0;
+	long out_capacity = size+1;
+	for (int i=0; i<nb_patches; i++)
+		out_capacity += strlen(patches[i].text);
+	char *out = malloc(out_capacity);
+
+	long copied = 0; // bytes of the origin already handled
+	int nb_line = 1; // line starting at line_offset
+	long line_offset = 0;
+
+	for (int i=0; i<nb_patches; i++)
+	{
+		if (patches[i].is_stale) continue;
+
+		// find the byte offsets of the range, going forward only
+		long range[2];
+		int lines[2] = {patches[i].line_start, patches[i].line_end};
+		int cols[2] = {patches[i].col_start, patches[i].col_end};
+		if (lines[0] < nb_line)
+			continue; // overlaps a previous patch
+		for (int j=0; j<2; j++)
+		{
+			while (nb_line < lines[j] && line_offset < size)
+			{
+				char *eol = memchr(content+line_offset, '\n', size-line_offset);
+				line_offset = (eol == NULL) ? size : eol-content+1;
+				nb_line++;
+			}
+			range[j] = line_offset+cols[j]-1;
+			if (nb_line < lines[j] || range[j] > size)
+				range[j] = size; // past the end of the file
+		}
+
+		if (range[0] < copied || range[1] < range[0])
+			continue; // overlaps a previous patch
+
+		memcpy(out+out_size, content+copied, range[0]-copied); // unchanged bytes
+		out_size += range[0]-copied;
+		int len = strlen(patches[i].text);
+		memcpy(out+out_size, patches[i].text, len); // replacement
+		out_size += len;
+		copied = range[1];
+		patches[i].is_applied = TRUE;
+	}
+	memcpy(out+out_size, content+copied, size-copied); // copy everything to the end
+	out_size += size-copied;
+
+	char *temp_name = malloc(strlen(filename)+6); // filename+".temp"
+	sprintf(temp_name, "%s.temp", filename);
+	FILE *fnew = fopen(temp_name, "w"); // destination file
+	int isError = (fnew == NULL);
+	if (!isError)
+	{
+		isError = (fwrite(out, 1, out_size, fnew) != (size_t)out_size);
+		isError |= (fclose(fnew) != 0);
+		if (!isError)
+		{
+			chmod(temp_name, st.st_mode & 07777); // keep the permissions of the origin
+			isError = (rename(temp_name, filename) != 0);
+		}
+		if (isError)
+			unlink(temp_name);
+	}
+
+	if (!isError)
+	{
+		// the patched lines are the new reference of their rows
+		int nb_lines = 0;
+		long *starts = index_lines(out, out_size, &nb_lines);
+		for (int i=0; i<nb_patches; i++)
+		{
+			int row = patch_row(el, &patches[i]);
+			if (!patches[i].is_applied || el->line_nb[row] < 1) continue;
+			int line = el->line_nb[row] + line_shift(patches, nb_patches, file_id, el->line_nb[row]);
+			el->line_hash[row] = (line <= nb_lines) ? code_hash(out+starts[line-1], starts[line]-starts[line-1]) : 0;
+		}
+		free(starts);
+
+		// a file that matched its stamp still matches every other row : keep the fast path
+		if (isUnchanged && stat(filename, &st) == 0)
+		{
+			stamp->size = st.st_size;
+			stamp->mtime = stat_mtime(&st);
+		}
+	}
+
+	free(out);
+	free(content);
+	free(temp_name);
+	return isError;
+}
+
+
+static int apply_patches(BlessErrorList *el, Patch *patches, int nb_patches, int *nb_stale)
+{
+	// write the patches, grouped by file : each file is read and written once
+	// the line numbers of the rows and fix-its are moved to follow the written lines
+	// nb_stale receives the number of patches refused because their line changed on disk
+	// returns TRUE if an error has happened
+	int isError = FALSE;
+	qsort(patches, nb_patches, sizeof(Patch), compare_patch);
+
+	int first = 0;
+	while (first < nb_patches)
+	{
+		int last = first;
+		while (last < nb_patches && patches[last].file_id == patches[first].file_id)
+			last++;
+		isError |= patch_file(el, patches[first].file_id, patches+first, last-first);
+		first = last;
+	}
+
+	int hasShift = FALSE;
+	*nb_stale = 0;
+	for (int i=0; i<nb_patches; i++)
+	{
+		*nb_stale += patches[i].is_stale;
+		if (!patches[i].is_applied) continue;
+		if (patches[i].fixit >= 0)
+			el->fixits[patches[i].fixit].is_applied = TRUE;
+		int added = 0;
+		for (char *c=patches[i].text; *c != '\0'; c++)
+			added += (*c == '\n');
+		hasShift |= (added != patches[i].line_end - patches[i].line_start);
+	}
+
+	if (hasShift)
+	{
+		for (int row=0; row<el->size; row++)
+			el->line_nb[row] += line_shift(patches, nb_patches, el->file_id[row], el->line_nb[row]);
+		for (int i=0; i<el->nb_fixits; i++)
+		{
+			FixIt *fixit = &el->fixits[i];
+			if (fixit->is_applied) continue;
+			fixit->line_start += line_shift(patches, nb_patches, fixit->file_id, fixit->line_start);
+			fixit->line_end += line_shift(patches, nb_patches, fixit->file_id, fixit->line_end);
+		}
+	}
+
+	return isError;
+}
+
+
+int bless_place_in_file(BlessErrorList *el, int *nb_stale)
+{
+	// for every edited row of the BlessErrorList, write the user-modified code at the specified line
+	// the rows whose line changed on disk stay edited, nb_stale receives their number
+	// returns TRUE if an error has happened
+	Patch *patches = malloc((el->size+1)*sizeof(Patch));
+	int nb_patches = 0;
+	int nb_unknown = 0;
+
+	for (int i=0; i<el->edited.size; i++)
+	{
+		int row = el->edited.rows[i];
+		if (!el->edited.values[i] || el->line_nb[row] < 1) continue; // untouched since the last write, or no line to write to (linker)
+		if (el->text[el->origin_code[row]] == '\0' || el->line_hash[row] == 0)
+		{
+			nb_unknown++; // no excerpt printed : the line on disk cannot be checked, nor rewritten whole
+			continue;
+		}
+		Patch *patch = &patches[nb_patches++];
+		patch->file_id = el->file_id[row];
+		patch->line_start = el->line_nb[row]; // the whole line, end of line included
+		patch->col_start = 1;
+		patch->line_end = el->line_nb[row]+1;
+		patch->col_end = 1;
+		patch->text = bless_pt_to_string(el, row);
+		patch->fixit = -1;
+		patch->row = row;
+		patch->is_applied = FALSE;
+		patch->is_stale = FALSE;
+	}
+
+	int isError = apply_patches(el, patches, nb_patches, nb_stale);
+	*nb_stale += nb_unknown;
+
+	for (int i=0; i<nb_patches; i++)
+	{
+		if (patches[i].is_applied)
+			bless_set_edited(el, patches[i].row, FALSE); // the file holds this version now
+		free(patches[i].text);
+	}
+	free(patches);
+	return isError;
+}
+
+
+static int row_matches(BlessErrorList *el, int row, char *filter)
+{
+	// whether the error messages or the file of a row contain filter (always TRUE for an empty filter)
+	if (filter[0] == '\0' || strstr(pool_get(el->pool, el->file_id[row]), filter) != NULL)
+		return TRUE;
+	for (int i=0; i<el->nb_msgs[row]; i++)
+	{
+		if (strstr(bless_error_msg(el, row, i), filter) != NULL)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+int bless_apply_fixits(BlessErrorList *el, char *filter, int *nb_applied, int *nb_stale)
+{
+	// write every fix-it not applied yet whose error messages or file contain filter (all for an empty filter)
+	// nb_stale receives the number of fix-its refused because their line changed on disk
+	// returns TRUE if an error has happened
+	Patch *patches = malloc((el->nb_fixits+1)*sizeof(Patch));
+	int nb_patches = 0;
+
+	for (int i=0; i<el->nb_fixits; i++)
+	{
+		FixIt *fixit = &el->fixits[i];
+		if (fixit->is_applied) continue;
+
+		if (!row_matches(el, fixit->row, filter)) continue;
+
+		Patch *patch = &patches[nb_patches++];
+		patch->file_id = fixit->file_id;
+		patch->line_start = fixit->line_start;
+		patch->col_start = fixit->col_start;
+		patch->line_end = fixit->line_end;
+		patch->col_end = fixit->col_end;
+		patch->text = el->text+fixit->text;
+		patch->fixit = i;
+		patch->row = -1;
+		patch->is_applied = FALSE;
+		patch->is_stale = FALSE;
+	}
+
+	int isError = apply_patches(el, patches, nb_patches, nb_stale);
+
+	*nb_applied = 0;
+	for (int i=0; i<nb_patches; i++)
+		*nb_applied += patches[i].is_applied;
+	free(patches);
+	return isError;
+}
+
+
+int bless_substitute(BlessErrorList *el, char *pattern, int isRegex, char *replacement, char *filter, int shouldApply, int *nb_rows, int *nb_files)
+{
+	// count (and replace if shouldApply) every occurrence of pattern in the code lines of the rows matching filter
+	// the lines are scanned in one flat buffer, the replaced lines become user edits
+	// returns the number of occurrences, -1 for an invalid pattern
+	regex_t expr;
+	regmatch_t match[1];
+	if (pattern[0] == '\0' || (isRegex && regcomp(&expr, pattern, 0) != 0))
+		return -1;
+
+	// flat buffer of the current code lines, null-separated
+	int *rows = malloc((el->size+1)*sizeof(int));
+	unsigned int *starts = malloc((el->size+1)*sizeof(unsigned int));
+	int nb_lines = 0;
+	unsigned int flat_size = 0;
+	unsigned int flat_capacity = 4096;
+	char *flat = malloc(flat_capacity);
+	for (int row=0; row<el->size; row++)
+	{
+		if (!row_matches(el, row, filter)) continue;
+		char *code = bless_pt_to_string(el, row);
+		rows[nb_lines] = row;
+		starts[nb_lines++] = blob_append(&flat, &flat_size, &flat_capacity, code, strlen(code));
+		free(code);
+	}
+
+	int nb_found = 0;
+	int pattern_len = strlen(pattern);
+	int replacement_len = strlen(replacement);
+	char *seen_files = calloc(el->pool->size+1, 1);
+	unsigned int out_size = 0;
+	unsigned int out_capacity = 256;
+	char *out = malloc(out_capacity); // replaced line being built
+	*nb_rows = 0;
+	*nb_files = 0;
+
+	for (int i=0; i<nb_lines; i++)
+	{
+		char *line = flat+starts[i];
+		char *pos = line; // start of the text not scanned yet
+		int nb_in_line = 0;
+		out_size = 0;
+
+		while (*pos != '\0')
+		{
+			char *found;
+			int found_len;
+			if (isRegex)
+			{
+				if (regexec(&expr, pos, 1, match, (pos == line) ? 0 : REG_NOTBOL) != 0)
+					break;
+				found = pos+match->rm_so;
+				found_len = match->rm_eo-match->rm_so;
+			}
+			else
+			{
+				found = strstr(pos, pattern);
+				if (found == NULL)
+					break;
+				found_len = pattern_len;
+			}
+
+			nb_in_line++;
+			if (shouldApply)
+			{
+				// text before the occurrence then the replacement, each null char is overwritten by the next piece
+				blob_append(&out, &out_size, &out_capacity, pos, found-pos);
+				out_size--;
+				blob_append(&out, &out_size, &out_capacity, replacement, replacement_len);
+				out_size--;
+			}
+			pos = found+found_len;
+			if (found_len == 0) // empty match, step over one char
+			{
+				if (*pos == '\0') break;
+				if (shouldApply)
+				{
+					blob_append(&out, &out_size, &out_capacity, pos, 1);
+					out_size--;
+				}
+				pos++;
+			}
+		}
+
+		if (nb_in_line == 0) continue;
+		nb_found += nb_in_line;
+		*nb_rows += 1;
+		int row = rows[i];
+		if (!seen_files[el->file_id[row]+1])
+		{
+			seen_files[el->file_id[row]+1] = TRUE;
+			*nb_files += 1;
+		}
+
+		if (shouldApply)
+		{
+			blob_append(&out, &out_size, &out_capacity, pos, strlen(pos)); // end of the line
+			BlessPieceTable *pt = bless_row_piece_table(el, row);
+			bless_pt_begin_change(pt); // undone in one step
+			bless_pt_set_text(el, pt, out);
+			bless_set_edited(el, row, TRUE);
+		}
+	}
+
+	if (isRegex)
+		regfree(&expr);
+	free(out);
+	free(seen_files);
+	free(flat);
+	free(starts);
+	free(rows);
+	return nb_found;
+}
+
+
+static int session_sections(BlessErrorList *el, SessionSection *sections)
+{
+	// list the arrays of a BlessErrorList stored in a session file, in file order
+	int n = 0;
+	unsigned long long rows = el->size;
+
+	sections[n].data = (void**)&el->line_nb; sections[n++].size = rows*sizeof(int);
+	sections[n].data = (void**)&el->column; sections[n++].size = rows*sizeof(unsigned short);
+	sections[n].data = (void**)&el->file_id; sections[n++].size = rows*sizeof(int);
+	sections[n].data = (void**)&el->function_id; sections[n++].size = rows*sizeof(int);
+	sections[n].data = (void**)&el->text_first; sections[n++].size = rows*sizeof(unsigned int);
+	sections[n].data = (void**)&el->nb_msgs; sections[n++].size = rows*sizeof(unsigned short);
+	sections[n].data = (void**)&el->nb_help; sections[n++].size = rows*sizeof(unsigned short);
+	sections[n].data = (void**)&el->origin_code; sections[n++].size = rows*sizeof(unsigned int);
+	sections[n].data = (void**)&el->line_hash; sections[n++].size = rows*sizeof(unsigned int);
+	sections[n].data = (void**)&el->severity; sections[n++].size = rows*sizeof(unsigned char);
+	sections[n].data = (void**)&el->tu_first; sections[n++].size = rows*sizeof(unsigned int);
+	sections[n].data = (void**)&el->nb_tus; sections[n++].size = rows*sizeof(unsigned short);
+	sections[n].data = (void**)&el->cause; sections[n++].size = rows*sizeof(int);
+	sections[n].data = (void**)&el->rank; sections[n++].size = rows*sizeof(int);
+	sections[n].data = (void**)&el->occurrences.rows; sections[n++].size = (unsigned long long)el->occurrences.size*sizeof(int);
+	sections[n].data = (void**)&el->occurrences.values; sections[n++].size = (unsigned long long)el->occurrences.size*sizeof(int);
+	sections[n].data = (void**)&el->nb_cascades.rows; sections[n++].size = (unsigned long long)el->nb_cascades.size*sizeof(int);
+	sections[n].data = (void**)&el->nb_cascades.values; sections[n++].size = (unsigned long long)el->nb_cascades.size*sizeof(int);
+	sections[n].data = (void**)&el->text; sections[n++].size = el->text_size;
+	sections[n].data = (void**)&el->text_offsets; sections[n++].size = (unsigned long long)el->nb_texts*sizeof(unsigned int);
+	sections[n].data = (void**)&el->tu_ids; sections[n++].size = (unsigned long long)el->nb_tu_ids*sizeof(int);
+	sections[n].data = (void**)&el->ranked; sections[n++].size = (unsigned long long)el->nb_ranked*sizeof(int);
+	sections[n].data = (void**)&el->fixits; sections[n++].size = (unsigned long long)el->nb_fixits*sizeof(FixIt);
+	sections[n].data = (void**)&el->stamps; sections[n++].size = (unsigned long long)el->nb_stamps*sizeof(FileStamp);
+	sections[n].data = (void**)&el->pool->offsets; sections[n++].size = (unsigned long long)el->pool->size*sizeof(unsigned int);
+	sections[n].data = (void**)&el->pool->text; sections[n++].size = el->pool->text_size;
+
+	return n;
+}
+
+
+static void write_section(FILE *f, SessionHeader *header, int i, void *data, unsigned long long size, unsigned long long *offset)
+{
+	// write an array at the current offset, padded to keep the next one 8-byte aligned
+	static const char padding[8] = {0};
+
+	header->sections[i] = *offset;
+	header->section_sizes[i] = size;
+	if (size > 0)
+		fwrite(data, 1, size, f);
+	*offset += size;
+	if (*offset % 8 != 0)
+	{
+		fwrite(padding, 1, 8 - *offset % 8, f);
+		*offset += 8 - *offset % 8;
+	}
+}
+
+
+int bless_save_session(char *path, BlessErrorList *el, char *command, int current_row)
+{
+	// write the parsed errors, the current row and the pending edits in a session file
+	// returns TRUE if an error has happened
+	SessionHeader header;
+	SessionSection sections[SESSION_MAX_SECTIONS];
+	unsigned long long offset = sizeof(SessionHeader);
+
+	char *temp_name = malloc(strlen(path)+6);
+	sprintf(temp_name, "%s.temp", path); // written aside, then renamed over the old session
+	FILE *f = fopen(temp_name, "w");
+	if (f == NULL)
+	{
+		free(temp_name);
+		return TRUE;
+	}
+
+	memset(&header, 0, sizeof(SessionHeader));
+	memcpy(header.magic, SESSION_MAGIC, 8);
+	header.version = SESSION_VERSION;
+	header.byte_order = SESSION_BYTE_ORDER;
+	header.size = el->size;
+	header.nb_texts = el->nb_texts;
+	header.nb_tu_ids = el->nb_tu_ids;
+	header.nb_ranked = el->nb_ranked;
+	header.nb_fixits = el->nb_fixits;
+	header.text_size = el->text_size;
+	header.pool_size = el->pool->size;
+	header.pool_text_size = el->pool->text_size;
+	header.nb_repeated = el->occurrences.size;
+	header.nb_folding = el->nb_cascades.size;
+	header.current_row = current_row;
+	fwrite(&header, sizeof(SessionHeader), 1, f); // placeholder, rewritten once the offsets are known
+
+	int n = session_sections(el, sections);
+	for (int i=0; i<n; i++)
+		write_section(f, &header, i, *sections[i].data, sections[i].size, &offset);
+
+	write_section(f, &header, n, command, strlen(command)+1, &offset);
+
+	// edited lines, as (row, offset, edited flag) and their text, without the undo history
+	int *edit_rows = malloc((el->edited.size+1)*sizeof(int));
+	unsigned int *edit_offsets = malloc((el->edited.size+1)*sizeof(unsigned int));
+	unsigned char *edit_flags = malloc(el->edited.size+1);
+	unsigned int edit_size = 0;
+	unsigned int edit_capacity = 256;
+	char *edit_text = malloc(edit_capacity);
+	for (int i=0; i<el->edited.size; i++)
+	{
+		int row = el->edited.rows[i];
+		char *str = bless_pt_to_string(el, row);
+		edit_rows[header.nb_edits] = row;
+		edit_flags[header.nb_edits] = el->edited.values[i];
+		edit_offsets[header.nb_edits] = blob_append(&edit_text, &edit_size, &edit_capacity, str, strlen(str));
+		header.nb_edits++;
+		free(str);
+	}
+	header.edit_text_size = edit_size;
+	write_section(f, &header, n+1, edit_rows, header.nb_edits*sizeof(int), &offset);
+	write_section(f, &header, n+2, edit_offsets, header.nb_edits*sizeof(unsigned int), &offset);
+	write_section(f, &header, n+3, edit_text, edit_size, &offset);
+	write_section(f, &header, n+4, edit_flags, header.nb_edits, &offset);
+	free(edit_rows);
+	free(edit_offsets);
+	free(edit_flags);
+	free(edit_text);
+
+	fseek(f, 0, SEEK_SET);
+	fwrite(&header, sizeof(SessionHeader), 1, f);
+	int isError = (ferror(f) != 0);
+	isError |= (fclose(f) != 0);
+	if (!isError && rename(temp_name, path) != 0)
+		isError = TRUE;
+	if (isError)
+		unlink(temp_name);
+	free(temp_name);
+	return isError;
+}
+
+
+static int is_session_consistent(BlessErrorList *el)
+{
+	// whether every offset, id and row read from a session points inside its arrays
+	if (el->size < 0 || el->nb_texts < 0 || el->nb_tu_ids < 0 || el->nb_ranked < 0 || el->nb_fixits < 0 || el->pool->size < 0
+		|| el->occurrences.size < 0 || el->nb_cascades.size < 0)
+		return FALSE; // count past INT_MAX
+	if (el->text_size == 0 || el->text[el->text_size-1] != '\0')
+		return FALSE; // the last string would be read past the text
+	if (el->pool->size > 0 && (el->pool->text_size == 0 || el->pool->text[el->pool->text_size-1] != '\0'))
+		return FALSE;
+
+	for (int i=0; i<el->nb_texts; i++)
+		if (el->text_offsets[i] >= el->text_size) return FALSE;
+	for (int id=0; id<el->pool->size; id++)
+		if (el->pool->offsets[id] >= el->pool->text_size) return FALSE;
+	for (int i=0; i<el->nb_ranked; i++)
+		if (el->ranked[i] < 0 || el->ranked[i] >= el->size) return FALSE;
+	for (int i=0; i<el->occurrences.size; i++)
+		if (el->occurrences.rows[i] < 0 || el->occurrences.rows[i] >= el->size || el->occurrences.values[i] < 1) return FALSE;
+	for (int i=0; i<el->nb_cascades.size; i++)
+		if (el->nb_cascades.rows[i] < 0 || el->nb_cascades.rows[i] >= el->size || el->nb_cascades.values[i] < 0) return FALSE;
+
+	for (int row=0; row<el->size; row++)
+	{
+		if ((unsigned long long)el->text_first[row]+el->nb_msgs[row]+el->nb_help[row] > (unsigned long long)el->nb_texts
+			|| el->origin_code[row] >= el->text_size
+			|| el->file_id[row] < -1 || el->file_id[row] >= el->pool->size
+			|| el->function_id[row] < -1 || el->function_id[row] >= el->pool->size
+			|| (unsigned long long)el->tu_first[row]+el->nb_tus[row] > (unsigned long long)el->nb_tu_ids
+			|| el->cause[row] < -1 || el->cause[row] >= el->size
+			|| el->rank[row] < -1 || el->rank[row] >= el->nb_ranked)
+			return FALSE;
+		for (unsigned int i=el->tu_first[row]; i<el->tu_first[row]+el->nb_tus[row]; i++)
+			if (el->tu_ids[i] < -1 || el->tu_ids[i] >= el->pool->size) return FALSE;
+	}
+
+	for (int i=0; i<el->nb_fixits; i++)
+	{
+		FixIt *fixit = &el->fixits[i];
+		if (fixit->row < 0 || fixit->row >= el->size || fixit->file_id < 0 || fixit->file_id >= el->pool->size
+			|| fixit->text >= el->text_size)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+
+BlessErrorList* bless_load_session(char *path, char *command, int *current_row)
+{
+	// map a session file saved for the same command and use its columns in place
+	// returns NULL if there is no usable session
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SessionHeader))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	// private mapping : the pages are shared with the page cache until written
+	char *mapping = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return NULL;
+
+	SessionHeader *header = (SessionHeader*)mapping;
+	if (memcmp(header->magic, SESSION_MAGIC, 8) != 0 || header->version != SESSION_VERSION
+		|| header->byte_order != SESSION_BYTE_ORDER)
+	{
+		munmap(mapping, st.st_size);
+		return NULL; // not a session, or from another version of Bless
+	}
+
+	BlessErrorList *el = calloc(1, sizeof(BlessErrorList));
+	el->pool = calloc(1, sizeof(StringPool));
+	el->size = header->size;
+	el->capacity = header->size;
+	el->nb_texts = header->nb_texts;
+	el->nb_tu_ids = header->nb_tu_ids;
+	el->nb_ranked = header->nb_ranked;
+	el->nb_fixits = header->nb_fixits;
+	el->fixits_capacity = header->nb_fixits;
+	el->text_size = header->text_size;
+	el->text_capacity = header->text_size;
+	el->pool->size = header->pool_size;
+	el->pool->text_size = header->pool_text_size;
+	el->nb_stamps = header->pool_size; // one stamp per interned string
+	el->occurrences.size = header->nb_repeated;
+	el->nb_cascades.size = header->nb_folding;
+
+	SessionSection sections[SESSION_MAX_SECTIONS];
+	int n = session_sections(el, sections);
+	int isValid = TRUE;
+	for (int i=0; i<n+5; i++)
+	{
+		unsigned long long size = (i < n) ? sections[i].size : header->section_sizes[i];
+		if (header->sections[i] % 8 != 0 || header->section_sizes[i] != size
+			|| header->sections[i] + size > (unsigned long long)st.st_size)
+			isValid = FALSE; // truncated or inconsistent file
+	}
+	if (header->section_sizes[n+1] != header->nb_edits*sizeof(int)
+		|| header->section_sizes[n+2] != header->nb_edits*sizeof(unsigned int)
+		|| header->section_sizes[n+3] != header->edit_text_size
+		|| header->section_sizes[n+4] != header->nb_edits)
+		isValid = FALSE;
+	char *saved_command = mapping+header->sections[n];
+	if (isValid && (header->section_sizes[n] != strlen(command)+1 || strcmp(saved_command, command) != 0))
+		isValid = FALSE; // session of another command
+
+	if (isValid)
+	{
+		for (int i=0; i<n; i++)
+			*sections[i].data = mapping+header->sections[i]; // use the arrays in place
+		isValid = is_session_consistent(el); // corrupted or crafted file
+	}
+	char *edit_text = mapping+header->sections[n+3];
+	if (isValid && header->edit_text_size > 0 && edit_text[header->edit_text_size-1] != '\0')
+		isValid = FALSE;
+
+	if (!isValid)
+	{
+		munmap(mapping, st.st_size);
+		free(el->pool);
+		free(el);
+		return NULL;
+	}
+
+	el->mapping = mapping;
+	el->mapping_size = st.st_size;
+
+	// the pool is small and may still grow : copy it to the heap and rebuild its buckets
+	StringPool *mapped_pool = el->pool;
+	el->pool = new_string_pool();
+	for (int id=0; id<mapped_pool->size; id++)
+	{
+		char *str = mapped_pool->text+mapped_pool->offsets[id];
+		pool_intern(el->pool, str, strlen(str));
+	}
+	free(mapped_pool);
+
+	// so are the sparse columns, whose buckets are not saved
+	SparseColumn *columns[2] = {&el->occurrences, &el->nb_cascades};
+	for (int c=0; c<2; c++)
+	{
+		SparseColumn mapped = *columns[c];
+		memset(columns[c], 0, sizeof(SparseColumn));
+		for (int i=0; i<mapped.size; i++)
+			sparse_add(columns[c], mapped.rows[i], mapped.values[i]);
+	}
+
+	// edited lines
+	el->added_capacity = header->edit_text_size+256;
+	el->added = malloc(el->added_capacity);
+	int *edit_rows = (int*)(mapping+header->sections[n+1]);
+	unsigned int *edit_offsets = (unsigned int*)(mapping+header->sections[n+2]);
+	unsigned char *edit_flags = (unsigned char*)(mapping+header->sections[n+4]);
+	for (unsigned int i=0; i<header->nb_edits; i++)
+	{
+		int row = edit_rows[i];
+		if (row < 0 || row >= el->size || edit_offsets[i] >= header->edit_text_size) continue;
+		bless_pt_set_text(el, bless_row_piece_table(el, row), edit_text+edit_offsets[i]);
+		bless_set_edited(el, row, edit_flags[i]);
+	}
+
+	*current_row = header->current_row;
+	if (*current_row < 0 || *current_row >= el->size)
+		*current_row = 0;
+	return el;
+}
+
+
+int bless_changed_files(BlessErrorList *el)
+{
+	// count the files whose size or modification time differ from their stamp, e.g. before resuming a session
+	int nb_changed = 0;
+	for (int id=0; id<el->nb_stamps; id++)
+	{
+		struct stat st;
+		if (el->stamps[id].size == -2) continue; // not a file with errors
+		if (stat(pool_get(el->pool, id), &st) != 0)
+			nb_changed += (el->stamps[id].size != -1); // removed since
+		else
+			nb_changed += (el->stamps[id].size != st.st_size || el->stamps[id].mtime != stat_mtime(&st));
+	}
+	return nb_changed;
+}
+
+
+int bless_next_row(BlessErrorList *el, int row, int direction, int isPriority)
+{
+	// row visited after row going forward (1) or backward (-1), -1 if there is none
+	if (isPriority)
+	{
+		int rank = el->rank[row]+direction;
+		if (el->rank[row] < 0 || rank < 0 || rank >= el->nb_ranked)
+			return -1;
+		return el->ranked[rank];
+	}
+	if (row+direction < 0 || row+direction >= el->size)
+		return -1;
+	return row+direction;
+}
+
+
+// LIBRARY API //
+
+
+BlessErrorList* bless_parse_fd(int fd)
+{
+	// parse the build output read from fd until EOF, the fd is left open
+	int copy = dup(fd);
+	FILE *f = (copy >= 0) ? fdopen(copy, "r") : NULL;
+	if (f == NULL)
+	{
+		if (copy >= 0) close(copy);
+		return NULL;
+	}
+	BlessErrorList *error_list = bless_parse_output(f);
+	fclose(f);
+	return error_list;
+}
+
+
+BlessErrorList* bless_parse_buffer(const char *buffer, size_t size)
+{
+	// parse a build output held in memory
+	FILE *f = fmemopen((void*)buffer, size, "r");
+	if (f == NULL)
+		return NULL;
+	BlessErrorList *error_list = bless_parse_output(f);
+	fclose(f);
+	return error_list;
+}
+
+
+int bless_diagnostic(BlessErrorList *el, int row, BlessDiagnostic *diag)
+{
+	// fill diag with a row of the list, returns FALSE past the last row
+	if (row < 0 || row >= el->size)
+		return FALSE;
+	diag->file = pool_get(el->pool, el->file_id[row]);
+	diag->function = pool_get(el->pool, el->function_id[row]);
+	diag->line = el->line_nb[row];
+	diag->column = el->column[row];
+	diag->severity = el->severity[row];
+	diag->occurrences = sparse_get(&el->occurrences, row, 1);
+	diag->nb_messages = el->nb_msgs[row];
+	diag->nb_help = el->nb_help[row];
+	diag->rank = el->rank[row];
+	diag->cause = el->cause[row];
+	diag->nb_cascades = sparse_get(&el->nb_cascades, row, 0);
+	diag->nb_units = el->nb_tus[row];
+	diag->file_id = el->file_id[row];
+	diag->is_edited = sparse_get(&el->edited, row, FALSE);
+	return TRUE;
+}
+
+
+int bless_nb_rows(BlessErrorList *el)
+{
+	return el->size;
+}
+
+
+int bless_nb_root_causes(BlessErrorList *el)
+{
+	return el->nb_ranked;
+}
+
+
+int bless_first_row(BlessErrorList *el, int isPriority)
+{
+	// row shown first : the best root cause, or the first row, -1 if the list is empty
+	if (isPriority && el->nb_ranked > 0)
+		return el->ranked[0];
+	return (el->size > 0) ? 0 : -1;
+}
+
+
+char* bless_unit_path(BlessErrorList *el, int row, int i)
+{
+	// i-th translation unit the error of a row was reported from
+	return pool_get(el->pool, el->tu_ids[el->tu_first[row]+i]);
+}
+
+
+int bless_nb_interned(BlessErrorList *el)
+{
+	// number of interned file and function names, the ids are below it
+	return el->pool->size;
+}
+
+
+char* bless_interned(BlessErrorList *el, int id)
+{
+	// file or function name interned under id, "" for an unknown id
+	return pool_get(el->pool, id);
+}
+
+
+int bless_nb_fixits(BlessErrorList *el)
+{
+	return el->nb_fixits;
+}
+
+
+int bless_fixit(BlessErrorList *el, int i, BlessFixIt *fixit)
+{
+	// fill fixit with the i-th fix-it hint, returns FALSE past the last one
+	if (i < 0 || i >= el->nb_fixits)
+		return FALSE;
+	fixit->row = el->fixits[i].row;
+	fixit->line_start = el->fixits[i].line_start;
+	fixit->col_start = el->fixits[i].col_start;
+	fixit->line_end = el->fixits[i].line_end;
+	fixit->col_end = el->fixits[i].col_end;
+	fixit->text = el->text+el->fixits[i].text;
+	fixit->is_applied = el->fixits[i].is_applied;
+	return TRUE;
+}
+
+
+int bless_is_edited(BlessErrorList *el, int row)
+{
+	// whether the code line of a row differs from its last written version
+	return sparse_get(&el->edited, row, FALSE);
+}
+
+
+void bless_set_edited(BlessErrorList *el, int row, int isEdited)
+{
+	// a row without piece table is never edited : one is created to hold the flag
+	if (!isEdited && sparse_find(&el->edited, row) < 0)
+		return;
+	bless_row_piece_table(el, row);
+	el->edited.values[sparse_find(&el->edited, row)] = (isEdited != 0);
+}
+
+
+int bless_has_user_code(BlessErrorList *el, int row)
+{
+	// whether the code line of a row has ever been edited, so it has a piece table
+	return sparse_find(&el->edited, row) >= 0;
+}
+
+
+int bless_pt_length(BlessPieceTable *pt)
+{
+	// number of chars of the current version of the line
+	return pt->current.length;
+}
+
+
+int bless_stage_edit(BlessErrorList *el, int row, const char *code)
+{
+	// replace the code line of a row, written by the next commit, returns TRUE on error
+	if (row < 0 || row >= el->size || code == NULL)
+		return TRUE;
+	BlessPieceTable *pt = bless_row_piece_table(el, row);
+	bless_pt_begin_change(pt); // undone in one step
+	bless_pt_set_text(el, pt, (char*)code);
+	bless_set_edited(el, row, TRUE);
+	return FALSE;
+}
+
+
+int bless_commit(BlessErrorList *el, int *nb_stale)
+{
+	// write every staged code line in its file, returns TRUE on error
+	return bless_place_in_file(el, nb_stale);
+}
+
+
+// SHARED SESSION DAEMON //
+
+
+static BlessConnection* new_connection(int fd)
+{
+	// buffer the messages of a connected socket
+	BlessConnection *conn = malloc(sizeof(BlessConnection));
+	conn->fd = fd;
+	conn->in_start = 0;
+	conn->in_size = 0;
+	conn->in_capacity = 4096;
+	conn->in = malloc(conn->in_capacity);
+	conn->out_start = 0;
+	conn->out_size = 0;
+	conn->out_capacity = 0;
+	conn->out = NULL;
+	return conn;
+}
+
+
+BlessConnection* bless_connect(char *socket_path)
+{
+	// connect to the daemon listening on socket_path, NULL if there is none
+	struct sockaddr_un addr;
+	if (strlen(socket_path) >= sizeof(addr.sun_path))
+		return NULL;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return NULL;
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	return new_connection(fd);
+}
+
+
+void bless_disconnect(BlessConnection *conn)
+{
+	close(conn->fd);
+	free(conn->in);
+	free(conn->out);
+	free(conn);
+}
+
+
+int bless_conn_fd(BlessConnection *conn)
+{
+	// socket of the connection, to poll it with the other inputs of a client
+	return conn->fd;
+}
+
+
+static int conn_flush(BlessConnection *conn)
+{
+	// send the queued bytes, until the socket would block if it is non-blocking, returns TRUE on error
+	while (conn->out_start < conn->out_size)
+	{
+		ssize_t n = send(conn->fd, conn->out+conn->out_start, conn->out_size-conn->out_start, MSG_NOSIGNAL); // a closed peer is an error, not a SIGPIPE
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break; // sent when the daemon polls it writable
+		if (n <= 0)
+			return TRUE;
+		conn->out_start += n;
+	}
+	if (conn->out_start == conn->out_size)
+	{
+		conn->out_start = 0;
+		conn->out_size = 0;
+	}
+	return FALSE;
+}
+
+
+static void conn_queue(BlessConnection *conn, char *buf, unsigned int size)
+{
+	// append bytes to the output queue
+	if (conn->out_start > 0 && conn->out_size+size > conn->out_capacity)
+	{
+		memmove(conn->out, conn->out+conn->out_start, conn->out_size-conn->out_start);
+		conn->out_size -= conn->out_start;
+		conn->out_start = 0;
+	}
+	if (conn->out_size+size > conn->out_capacity)
+	{
+		while (conn->out_size+size > conn->out_capacity)
+			conn->out_capacity = (conn->out_capacity == 0) ? 4096 : conn->out_capacity*2;
+		conn->out = realloc(conn->out, conn->out_capacity);
+	}
+	memcpy(conn->out+conn->out_size, buf, size);
+	conn->out_size += size;
+}
+
+
+int bless_send(BlessConnection *conn, char *kind, int row, int flag, char *text)
+{
+	// send one message, text may be NULL, returns TRUE on error
+	// what a non-blocking socket cannot take yet is queued, up to CONN_QUEUE_MAX bytes
+	char header[CONN_HEADER_MAX];
+	unsigned int len = (text == NULL) ? 0 : strlen(text)+1;
+	int header_len = snprintf(header, sizeof(header), "%s %d %d %u\n", kind, row, flag, len);
+	if (conn->out_size-conn->out_start+header_len+len > CONN_QUEUE_MAX)
+		return TRUE; // the peer stopped reading
+	conn_queue(conn, header, header_len);
+	conn_queue(conn, text, len);
+	return conn_flush(conn);
+}
+
+
+int bless_conn_fill(BlessConnection *conn)
+{
+	// append the bytes waiting on the socket, the texts of the previous messages become invalid
+	// returns TRUE once the peer is gone
+	if (conn->in_start > 0)
+	{
+		memmove(conn->in, conn->in+conn->in_start, conn->in_size-conn->in_start);
+		conn->in_size -= conn->in_start;
+		conn->in_start = 0;
+	}
+	if (conn->in_size == conn->in_capacity)
+	{
+		conn->in_capacity *= 2;
+		conn->in = realloc(conn->in, conn->in_capacity);
+	}
+
+	ssize_t n = read(conn->fd, conn->in+conn->in_size, conn->in_capacity-conn->in_size);
+	if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		return FALSE;
+	if (n <= 0)
+		return TRUE;
+	conn->in_size += n;
+	return FALSE;
+}
+
+
+int bless_conn_next(BlessConnection *conn, BlessMessage *msg)
+{
+	// read the next buffered message, returns FALSE if it is not complete yet
+	char *start = conn->in+conn->in_start;
+	unsigned int available = conn->in_size-conn->in_start;
+	char *end = memchr(start, '\n', (available < CONN_HEADER_MAX) ? available : CONN_HEADER_MAX);
+	if (end == NULL)
+	{
+		if (available >= CONN_HEADER_MAX)
+			conn->in_start = conn->in_size; // not a header, dropped
+		return FALSE;
+	}
+
+	*end = '\0';
+	int isHeader = (sscanf(start, "%7s %d %d %u", msg->kind, &msg->row, &msg->flag, &msg->len) == 4);
+	*end = '\n';
+	if (!isHeader || msg->len > CONN_TEXT_MAX)
+	{
+		conn->in_start = conn->in_size; // garbage, dropped
+		return FALSE;
+	}
+
+	unsigned int header_len = end+1-start;
+	if (available-header_len < msg->len)
+		return FALSE; // text not fully received
+
+	if (msg->len == 0)
+	{
+		*end = '\0'; // empty text
+		msg->text = end;
+	}
+	else
+	{
+		msg->text = end+1;
+		msg->text[msg->len-1] = '\0';
+	}
+	conn->in_start += header_len+msg->len;
+	return TRUE;
+}
+
+
+static void broadcast(BlessConnection **clients, int nb_clients, BlessConnection *except, char *kind, int row, int flag, char *text)
+{
+	// send a message to every client but one, the clients that cannot receive it are shut down
+	for (int i=0; i<nb_clients; i++)
+	{
+		if (clients[i] != except && bless_send(clients[i], kind, row, flag, text))
+			shutdown(clients[i]->fd, SHUT_RDWR); // closed at its next poll
+	}
+}
+
+
+static void broadcast_row(BlessConnection **clients, int nb_clients, BlessConnection *except, BlessErrorList *el, int row)
+{
+	// send the code line of a row and its edited flag
+	char *str = bless_pt_to_string(el, row);
+	broadcast(clients, nb_clients, except, "EDIT", row, bless_is_edited(el, row), str);
+	free(str);
+}
+
+
+static long long monotonic_ms()
+{
+	// current time in milliseconds, unaffected by clock changes
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+
+static volatile sig_atomic_t isServing; // cleared by bless_stop_serving
+
+
+void bless_stop_serving()
+{
+	// called from a signal handler : the poll of bless_serve is interrupted, then it saves and returns
+	isServing = FALSE;
+}
+
+
+static BlessErrorList* launch(char *command, int isLog, int max_errors, int isFirstUnit)
+{
+	// errors served by the daemon, with the same caps as a terminal launch
+	if (isLog)
+		return bless_read_log(command);
+	return bless_run_until(command, max_errors, isFirstUnit, NULL);
+}
+
+
+static pid_t start_build(char *command, int isLog, int max_errors, int isFirstUnit, char *next_path,
+	int listener, BlessConnection **clients, int nb_clients, int *done_fd)
+{
+	// relaunch the command in a child process, which saves its errors in next_path
+	// done_fd receives a pipe closed when the child exits, returns -1 if it cannot start
+	int fds[2];
+	if (pipe(fds) != 0)
+		return -1;
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		signal(SIGINT, SIG_DFL); // stopped with the daemon
+		signal(SIGTERM, SIG_DFL);
+		close(fds[0]);
+		close(listener);
+		for (int i=0; i<nb_clients; i++)
+			close(clients[i]->fd); // served by the parent only
+		BlessErrorList *el = launch(command, isLog, max_errors, isFirstUnit);
+		_exit(el == NULL || bless_save_session(next_path, el, command, 0));
+	}
+	close(fds[1]);
+	if (pid < 0)
+	{
+		close(fds[0]);
+		return -1;
+	}
+	*done_fd = fds[0];
+	return pid;
+}
+
+
+int bless_serve(char *socket_path, char *session_path, char *command, int isLog, int max_errors, int isFirstUnit)
+{
+	// run the build once and share its errors : the clients map the session file, then send their edits
+	// to this single writer, which applies them, forwards them and writes the files
+	// the edits are saved after a delay, and the relaunches run in a child while the clients are served
+	// the client sockets are non-blocking : a client that stops reading is dropped, not waited for
+	// returns TRUE if the daemon cannot start, otherwise serves until bless_stop_serving
+	struct sockaddr_un addr;
+	BlessConnection *clients[DAEMON_CLIENTS];
+	struct pollfd fds[DAEMON_CLIENTS+2];
+	int nb_clients = 0;
+	int generation = 1; // launch number, sent with each session to load
+	char message[128];
+	long long save_time = -1; // time the edits must be saved by, -1 if the session file is up to date
+	pid_t builder = -1; // child running the relaunched command, -1 if none
+	int build_fd = -1; // pipe closed when the builder exits
+
+	char shared_path[4096]; // absolute : the clients may run in another directory
+	char next_path[sizeof(shared_path)+8]; // session saved by the builder
+	if (strlen(socket_path) >= sizeof(addr.sun_path) || strlen(session_path) >= sizeof(shared_path)/2)
+		return TRUE;
+	BlessConnection *running = bless_connect(socket_path);
+	if (running != NULL)
+	{
+		bless_disconnect(running);
+		return TRUE; // another daemon serves this socket
+	}
+	unlink(socket_path); // left by a killed daemon
+
+	if (session_path[0] == '/')
+		snprintf(shared_path, sizeof(shared_path), "%s", session_path);
+	else if (getcwd(shared_path, sizeof(shared_path)-strlen(session_path)-1) != NULL)
+		sprintf(shared_path+strlen(shared_path), "/%s", session_path);
+	else
+		return TRUE;
+	sprintf(next_path, "%s.next", shared_path);
+
+	isServing = TRUE;
+	BlessErrorList *el = launch(command, isLog, max_errors, isFirstUnit);
+	if (el == NULL)
+		return TRUE;
+	if (bless_save_session(shared_path, el, command, 0))
+	{
+		bless_free_error_list(el);
+		return TRUE;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 16) != 0)
+	{
+		if (listener >= 0) close(listener);
+		bless_free_error_list(el);
+		return TRUE;
+	}
+
+	while (isServing)
+	{
+		int nb_polled = nb_clients;
+		fds[0].fd = listener;
+		fds[0].events = POLLIN;
+		for (int i=0; i<nb_polled; i++)
+		{
+			fds[i+1].fd = clients[i]->fd;
+			fds[i+1].events = POLLIN | ((clients[i]->out_size > 0) ? POLLOUT : 0);
+		}
+		int nb_fds = nb_polled+1;
+		if (build_fd >= 0)
+		{
+			fds[nb_fds].fd = build_fd;
+			fds[nb_fds++].events = POLLIN;
+		}
+		int wait_ms = -1;
+		if (save_time >= 0)
+			wait_ms = (save_time > monotonic_ms()) ? save_time-monotonic_ms() : 0;
+		if (poll(fds, nb_fds, wait_ms) < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		if (save_time >= 0 && monotonic_ms() >= save_time)
+		{
+			save_time = -1; // the edits of the last second in one write
+			if (bless_save_session(shared_path, el, command, 0))
+				broadcast(clients, nb_clients, NULL, "MSG", 0, 0, "Cannot save the shared session");
+		}
+
+		if (build_fd >= 0 && fds[nb_polled+1].revents != 0)
+		{
+			// the relaunch is over : its session replaces the shared one
+			int status;
+			close(build_fd);
+			build_fd = -1;
+			waitpid(builder, &status, 0);
+			builder = -1;
+			int unused;
+			BlessErrorList *relaunched = NULL;
+			if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && rename(next_path, shared_path) == 0)
+				relaunched = bless_load_session(shared_path, command, &unused);
+			if (relaunched == NULL)
+			{
+				unlink(next_path);
+				broadcast(clients, nb_clients, NULL, "MSG", 0, 0, "Cannot read the build log");
+			}
+			else
+			{
+				bless_free_error_list(el);
+				el = relaunched;
+				save_time = -1; // the edits were written before the relaunch
+				generation++;
+				broadcast(clients, nb_clients, NULL, "LOAD", generation, 0, shared_path);
+			}
+		}
+
+		if (fds[0].revents & POLLIN)
+		{
+			int fd = accept(listener, NULL, NULL);
+			if (fd >= 0 && nb_clients == DAEMON_CLIENTS)
+			{
+				close(fd); // full
+			}
+			else if (fd >= 0)
+			{
+				// the session file holds the errors and every edit applied so far
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+				if (save_time >= 0)
+				{
+					save_time = -1;
+					bless_save_session(shared_path, el, command, 0);
+				}
+				clients[nb_clients] = new_connection(fd);
+				bless_send(clients[nb_clients], "CMD", 0, 0, command);
+				bless_send(clients[nb_clients], "LOAD", generation, 0, shared_path);
+				nb_clients++;
+			}
+		}
+
+		for (int i=nb_polled-1; i>=0; i--) // backward : a closed client is replaced by the last one
+		{
+			if (fds[i+1].revents == 0) continue;
+			BlessConnection *conn = clients[i];
+			int isGone = FALSE;
+			if (fds[i+1].revents & POLLOUT)
+				isGone = conn_flush(conn); // the queue of a client reading again
+			if (fds[i+1].revents & ~POLLOUT)
+				isGone |= bless_conn_fill(conn);
+			BlessMessage msg;
+
+			while (!isGone && bless_conn_next(conn, &msg))
+			{
+				int isChanged = TRUE; // whether the session must be saved again
+
+				if (builder >= 0 && (strcmp(msg.kind, "EDIT") == 0 || strcmp(msg.kind, "WRITE") == 0
+					|| strcmp(msg.kind, "FIXIT") == 0 || strcmp(msg.kind, "RUN") == 0))
+				{
+					// the errors are about to be replaced : the edit is undone in its client
+					isChanged = FALSE;
+					if (strcmp(msg.kind, "EDIT") == 0 && msg.row >= 0 && msg.row < el->size)
+						broadcast_row(&conn, 1, NULL, el, msg.row);
+					bless_send(conn, "MSG", 0, 0, "The command is running, please wait");
+				}
+				else if (strcmp(msg.kind, "EDIT") == 0 && msg.row >= 0 && msg.row < el->size)
+				{
+					char *current = bless_has_user_code(el, msg.row) ? bless_pt_to_string(el, msg.row) : NULL;
+					if (current == NULL || strcmp(current, msg.text) != 0)
+						bless_stage_edit(el, msg.row, msg.text);
+					free(current);
+					bless_set_edited(el, msg.row, msg.flag);
+					broadcast_row(clients, nb_clients, conn, el, msg.row);
+				}
+				else if (strcmp(msg.kind, "WRITE") == 0)
+				{
+					int *written = malloc((el->size+1)*sizeof(int));
+					int nb_written = 0;
+					int nb_stale = 0;
+					for (int j=0; j<el->edited.size; j++)
+						if (el->edited.values[j]) written[nb_written++] = el->edited.rows[j];
+					int isError = bless_place_in_file(el, &nb_stale);
+					for (int j=0; j<nb_written; j++)
+						broadcast_row(clients, nb_clients, NULL, el, written[j]); // the written rows are no longer edited
+					free(written);
+					if (isError)
+						sprintf(message, "ERROR IN WRITE !");
+					else
+						sprintf(message, "%d lines written, %d changed on disk not written", nb_written-nb_stale, nb_stale);
+					broadcast(clients, nb_clients, NULL, "MSG", 0, 0, message);
+				}
+				else if (strcmp(msg.kind, "FIXIT") == 0)
+				{
+					int nb_applied = 0;
+					int nb_stale = 0;
+					int isError = bless_apply_fixits(el, msg.text, &nb_applied, &nb_stale);
+					sprintf(message, "%s%d fix-its applied, %d stale refused, relaunch to refresh the errors",
+						isError ? "ERROR IN WRITE ! " : "", nb_applied, nb_stale);
+					broadcast(clients, nb_clients, NULL, "MSG", 0, 0, message);
+				}
+				else if (strcmp(msg.kind, "RUN") == 0)
+				{
+					isChanged = FALSE;
+					int hasEdit = FALSE;
+					for (int j=0; j<el->edited.size; j++)
+						hasEdit |= el->edited.values[j];
+					if (hasEdit)
+					{
+						bless_send(conn, "MSG", 0, 0, "Please save the changes for relaunching");
+						continue;
+					}
+
+					builder = start_build(command, isLog, max_errors, isFirstUnit, next_path, listener, clients, nb_clients, &build_fd);
+					if (builder < 0)
+						bless_send(conn, "MSG", 0, 0, "Cannot relaunch the command");
+					else
+						broadcast(clients, nb_clients, NULL, "MSG", 0, 0, "Relaunching the command");
+				}
+				else
+				{
+					isChanged = FALSE; // unknown, ignored
+				}
+
+				if (isChanged && save_time < 0)
+					save_time = monotonic_ms()+DAEMON_SAVE_DELAY;
+			}
+
+			if (isGone)
+			{
+				bless_disconnect(conn);
+				clients[i] = clients[--nb_clients];
+			}
+		}
+	}
+
+	if (builder >= 0)
+	{
+		kill(builder, SIGTERM);
+		close(build_fd);
+		waitpid(builder, NULL, 0);
+		unlink(next_path);
+	}
+	if (save_time >= 0)
+		bless_save_session(shared_path, el, command, 0);
+	for (int i=0; i<nb_clients; i++)
+		bless_disconnect(clients[i]);
+	close(listener);
+	unlink(socket_path);
+	bless_free_error_list(el);
+	return FALSE;
+}
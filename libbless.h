@@ -0,0 +1,135 @@
+// libbless : the parser, the edits and the patch writer of Bless, without any terminal
+// a client runs or reads a build, walks its diagnostics, stages new code lines and commits them to the files
+#ifndef LIBBLESS_H
+#define LIBBLESS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define BLESS_SEVERITY_NOTE 0
+#define BLESS_SEVERITY_WARNING 1
+#define BLESS_SEVERITY_ERROR 2
+#define BLESS_SEVERITY_FATAL 3
+
+#define BLESS_SESSION_FILE ".bless_session" // default session file, in the current directory
+#define BLESS_SOCKET_FILE ".bless_socket" // default socket of the shared session daemon
+
+// opaque handles : their layout is private to the library, read through the bless_ functions
+
+typedef struct BlessErrorList BlessErrorList; // parsed rows of a build, freed with bless_free_error_list
+typedef struct BlessPieceTable BlessPieceTable; // edits of one code line, owned by its BlessErrorList
+typedef struct BlessConnection BlessConnection; // buffered end of the daemon socket
+
+
+// diagnostic seen by a client of the library
+
+typedef struct BlessDiagnostic { // one row of a BlessErrorList
+	const char *file; // file of the error
+	const char *function; // function the error is in, "" if unknown
+	int line; // line number, 0 if unknown (linker)
+	int column; // column, 0 if unknown
+	int severity; // BLESS_SEVERITY_*
+	int occurrences; // number of times the error was reported
+	int nb_messages; // number of messages, read with error_msg
+	int nb_help; // number of help lines, read with help_line
+	int rank; // position among the root causes, -1 for a cascade
+	int cause; // row of the likely root cause of a cascade, -1 otherwise
+	int nb_cascades; // number of errors folded under this one
+	int nb_units; // number of translation units it was reported from, read with unit_path
+	int file_id; // interned id of the file, for tables indexed by file, -1 if unknown
+	int is_edited; // whether a staged code line waits to be committed
+} BlessDiagnostic;
+
+
+typedef struct BlessFixIt { // fix-it hint suggested by the compiler
+	int row; // row of the error suggesting it
+	int line_start; // line of the start of the replaced range
+	int col_start; // first replaced byte, from 1
+	int line_end; // line of the end of the replaced range
+	int col_end; // byte after the replaced range
+	const char *text; // replacement
+	int is_applied; // whether it has been written in the file
+} BlessFixIt;
+
+
+// shared session daemon
+
+typedef struct BlessMessage { // "KIND row flag len\n" followed by len bytes of text
+	char kind[8]; // LOAD, EDIT and MSG from the daemon, EDIT, WRITE, FIXIT and RUN from a client
+	int row; // edited row, or generation of the loaded session
+	int flag; // is_edited flag of an EDIT
+	char *text; // null-terminated, valid until the next bless_conn_fill
+	unsigned int len; // bytes of text, null terminator included
+} BlessMessage;
+
+
+// parsing : the BlessErrorList returned is freed with bless_free_error_list
+
+BlessErrorList* bless_run_command(char* user_cmd); // run a command and parse its errors
+BlessErrorList* bless_run_until(char *user_cmd, int max_errors, int isFirstUnit, int *isStopped); // stop after max_errors errors (0 for all) or the first failed unit
+BlessErrorList* bless_read_log(char *path); // parse a plain, gzip or zstd build log, NULL if it cannot be read
+BlessErrorList* bless_parse_output(FILE *p); // parse the output of a build until EOF
+BlessErrorList* bless_parse_until(FILE *p, int max_errors, int isFirstUnit, int *isStopped); // parse until EOF or enough errors
+BlessErrorList* bless_parse_fd(int fd); // parse until EOF, the fd is left open, NULL if it cannot be read
+BlessErrorList* bless_parse_buffer(const char *buffer, size_t size); // parse a build output in memory, NULL on error
+void bless_free_error_list(BlessErrorList *error_list);
+
+// diagnostics
+
+int bless_nb_rows(BlessErrorList *el);
+int bless_diagnostic(BlessErrorList *el, int row, BlessDiagnostic *diag); // 0 past the last row
+char* bless_error_msg(BlessErrorList *el, int row, int i);
+char* bless_help_line(BlessErrorList *el, int row, int i);
+char* bless_unit_path(BlessErrorList *el, int row, int i);
+char* bless_origin_code(BlessErrorList *el, int row);
+int bless_nb_interned(BlessErrorList *el); // bound of the file ids
+char* bless_interned(BlessErrorList *el, int id); // file or function name, "" for an unknown id
+int bless_nb_fixits(BlessErrorList *el);
+int bless_fixit(BlessErrorList *el, int i, BlessFixIt *fixit); // 0 past the last fix-it
+int bless_count_severity(BlessErrorList *el, int severity);
+int bless_nb_root_causes(BlessErrorList *el);
+int bless_first_row(BlessErrorList *el, int isPriority); // -1 if there is no row
+int bless_next_row(BlessErrorList *el, int row, int direction, int isPriority);
+
+// edits : each change can be undone, nothing is written before a commit
+
+int bless_stage_edit(BlessErrorList *el, int row, const char *code); // replace the code line of a row, nonzero on error
+int bless_is_edited(BlessErrorList *el, int row); // staged and not written yet
+void bless_set_edited(BlessErrorList *el, int row, int isEdited);
+int bless_has_user_code(BlessErrorList *el, int row); // edited at least once
+BlessPieceTable* bless_row_piece_table(BlessErrorList *el, int row);
+void bless_pt_begin_change(BlessPieceTable *pt);
+void bless_pt_insert(BlessErrorList *el, BlessPieceTable *pt, int pos, char chr);
+void bless_pt_delete(BlessPieceTable *pt, int pos);
+void bless_pt_set_text(BlessErrorList *el, BlessPieceTable *pt, char *str);
+int bless_pt_undo(BlessPieceTable *pt);
+int bless_pt_redo(BlessPieceTable *pt);
+void bless_pt_revert(BlessErrorList *el, int row); // back to the original code, can be undone
+int bless_pt_length(BlessPieceTable *pt);
+char* bless_pt_to_string(BlessErrorList *el, int row); // to free
+
+// patches : nonzero on error, the lines changed on disk since the parse are counted in nb_stale and kept staged
+
+int bless_commit(BlessErrorList *el, int *nb_stale); // write every staged code line
+int bless_place_in_file(BlessErrorList *el, int *nb_stale);
+int bless_apply_fixits(BlessErrorList *el, char *filter, int *nb_applied, int *nb_stale);
+int bless_substitute(BlessErrorList *el, char *pattern, int isRegex, char *replacement, char *filter, int shouldApply, int *nb_rows, int *nb_files);
+
+// sessions
+
+int bless_save_session(char *path, BlessErrorList *el, char *command, int current_row);
+BlessErrorList* bless_load_session(char *path, char *command, int *current_row);
+int bless_changed_files(BlessErrorList *el); // number of files modified on disk since the parse or the last write
+
+// shared session daemon : one process parses the build and writes the files, its clients map its session
+
+int bless_serve(char *socket_path, char *session_path, char *command, int isLog, int max_errors, int isFirstUnit); // nonzero if it cannot start
+void bless_stop_serving(); // async-signal-safe : bless_serve saves the session and returns
+BlessConnection* bless_connect(char *socket_path); // NULL if no daemon listens
+void bless_disconnect(BlessConnection *conn);
+int bless_conn_fd(BlessConnection *conn); // to poll
+int bless_send(BlessConnection *conn, char *kind, int row, int flag, char *text); // nonzero on error
+int bless_conn_fill(BlessConnection *conn); // read what arrived, nonzero once the peer is gone
+int bless_conn_next(BlessConnection *conn, BlessMessage *msg); // 0 when no complete message is buffered
+
+#endif